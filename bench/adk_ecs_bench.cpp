@@ -0,0 +1,242 @@
+/*
+    Microbenchmarks for ADK_ECS.
+
+    Prints one CSV row per measurement to stdout so runs before and after a
+    storage change can be diffed or loaded into a spreadsheet:
+
+        benchmark,entities,threads,ns_per_entity,peak_rss_kb
+
+    Pass --quick to skip the 1M entity runs.
+*/
+
+#include <adk/adk_ecs.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+namespace
+{
+
+using registry = adk::ecs::registry<std::uint64_t>;
+using entity = registry::entity_id_type;
+
+struct position { float x, y, z; };
+struct velocity { float x, y, z; };
+struct health { int value; };
+struct team { int value; };
+struct rare { int value; };
+
+// Sink that keeps results observable so loops aren't optimized out
+volatile std::uint64_t sink = 0;
+
+std::size_t peak_rss_kb()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;
+    #else
+        return usage.ru_maxrss;
+    #endif
+#endif
+}
+
+void report(const char* name, std::size_t entities, std::size_t threads, double nanoseconds)
+{
+    std::printf("%s,%zu,%zu,%.3f,%zu\n", name, entities, threads,
+        nanoseconds / static_cast<double>(entities), peak_rss_kb());
+    std::fflush(stdout);
+}
+
+/**
+ * Runs func a few times and returns the fastest run in nanoseconds. setup runs
+ * before each repetition and isn't timed.
+ */
+template <typename Setup, typename Func>
+double measure(Setup setup, Func func, int repetitions = 5)
+{
+    double best = 0.0;
+    for (int i = 0; i < repetitions; i++) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        const auto end = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double, std::nano>(end - start).count();
+        best = i == 0 ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+template <typename Func>
+double measure(Func func, int repetitions = 5)
+{
+    return measure([]() {}, func, repetitions);
+}
+
+registry make_world(std::size_t count)
+{
+    registry reg;
+    reg.create_n(count, position{ 1.0f, 2.0f, 3.0f }, velocity{ 0.1f, 0.2f, 0.3f },
+        health{ 100 }, team{ 1 });
+    return reg;
+}
+
+void bench_churn(std::size_t count)
+{
+    registry reg;
+    std::vector<entity> ids(count);
+    report("create_destroy", count, 1, measure([&]() {
+        for (std::size_t i = 0; i < count; i++) {
+            ids[i] = reg.new_entity();
+            reg.assign<position>(ids[i], position{});
+        }
+        for (const auto id : ids) {
+            reg.delete_entity(id);
+        }
+    }));
+    report("create_n_destroy_range", count, 1, measure([&]() {
+        reg.create_n(std::span<entity>(ids), position{});
+        reg.destroy_range(ids);
+    }));
+}
+
+void bench_iteration(std::size_t count)
+{
+    auto reg = make_world(count);
+    report("for_each_1", count, 1, measure([&]() {
+        reg.for_each<position>([](entity, position& p) {
+            p.x += 1.0f;
+        });
+    }));
+    report("for_each_2", count, 1, measure([&]() {
+        reg.for_each<position, velocity>([](entity, position& p, velocity& v) {
+            p.x += v.x;
+            p.y += v.y;
+            p.z += v.z;
+        });
+    }));
+    report("for_each_4", count, 1, measure([&]() {
+        reg.for_each<position, velocity, health, team>([](entity, position& p, velocity& v, health& h, team& t) {
+            p.x += v.x;
+            h.value += t.value;
+        });
+    }));
+}
+
+void bench_parallel(std::size_t count)
+{
+    auto reg = make_world(count);
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= hardware; threads *= 2) {
+        adk::ecs::thread_pool pool(threads - 1);
+        report("par_for_each_2", count, threads, measure([&]() {
+            reg.par_for_each<position, velocity>(pool, [](entity, position& p, velocity& v) {
+                p.x += v.x;
+                p.y += v.y;
+                p.z += v.z;
+            });
+        }));
+    }
+}
+
+void bench_random_get(std::size_t count)
+{
+    auto reg = make_world(count);
+    std::vector<entity> ids;
+    ids.reserve(count);
+    reg.for_each<>([&ids](entity e) {
+        ids.push_back(e);
+    });
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+    report("random_get", count, 1, measure([&]() {
+        std::uint64_t total = 0;
+        for (const auto id : ids) {
+            total += reg.get<health>(id).value;
+        }
+        sink = sink + total;
+    }));
+}
+
+void bench_sparse_query(std::size_t count)
+{
+    auto reg = make_world(count);
+    std::size_t i = 0;
+    reg.for_each<>([&reg, &i](entity e) {
+        if (i++ % 100 == 0) {
+            reg.assign<rare>(e, rare{ 1 });
+        }
+    });
+    report("sparse_query_1pct", count, 1, measure([&]() {
+        std::uint64_t total = 0;
+        reg.for_each<position, rare>([&total](entity, position&, rare& r) {
+            total += r.value;
+        });
+        sink = sink + total;
+    }));
+}
+
+void bench_assign_unassign(std::size_t count)
+{
+    auto reg = make_world(count);
+    std::vector<entity> ids;
+    ids.reserve(count);
+    reg.for_each<>([&ids](entity e) {
+        ids.push_back(e);
+    });
+    report("assign_unassign", count, 1, measure([&]() {
+        for (const auto id : ids) {
+            reg.assign<rare>(id, rare{ 2 });
+        }
+        for (const auto id : ids) {
+            reg.unassign<rare>(id);
+        }
+    }));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--quick") {
+            quick = true;
+        }
+    }
+
+    std::vector<std::size_t> sizes = { 10'000, 100'000 };
+    if (!quick) {
+        sizes.push_back(1'000'000);
+    }
+
+    std::printf("benchmark,entities,threads,ns_per_entity,peak_rss_kb\n");
+    for (const auto size : sizes) {
+        bench_churn(size);
+        bench_iteration(size);
+        bench_parallel(size);
+        bench_random_get(size);
+        bench_sparse_query(size);
+        bench_assign_unassign(size);
+    }
+    return static_cast<int>(sink & 0);
+}
@@ -12,15 +12,34 @@
 #ifndef ADK_ECS_HPP
 #define ADK_ECS_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <istream>
 #include <iterator>
 #include <limits>
 #include <memory>
-#include <queue>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <thread>
 #include <tuple>
-#include <typeindex>
-#include <unordered_map>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 // User can define AECS_USE_ASSERTIONS to enable debugging assertions.
@@ -31,18 +50,95 @@
     #define ADK_ASSERT(...) ((void)0);
 #endif
 
+// User can define ADK_ECS_INSTRUMENTATION to time queries and systems and count
+// candidates rejected by views, see registry::stats. Off by default.
+#ifdef ADK_ECS_INSTRUMENTATION
+    #define ADK_ECS_INSTRUMENT(...) __VA_ARGS__
+#else
+    #define ADK_ECS_INSTRUMENT(...)
+#endif
+
+// Signature scans use SSE2 or AVX2 when the compiler targets them. User can
+// define ADK_ECS_NO_SIMD to force the scalar fallback.
+#if !defined(ADK_ECS_NO_SIMD) && defined(__AVX2__)
+    #define ADK_ECS_AVX2
+    #define ADK_ECS_SSE2
+    #include <immintrin.h>
+#elif !defined(ADK_ECS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define ADK_ECS_SSE2
+    #include <emmintrin.h>
+#endif
+
+// Parallel loops hand exceptions thrown on any thread back to their caller
+// when the compiler has exceptions enabled.
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+    #define ADK_ECS_EXCEPTIONS
+    #include <exception>
+#endif
+
+// Declared here so snapshots and split components can use reflection metadata
+// from adk_reflect.hpp without depending on it.
+namespace adk::reflect
+{
+
+template <typename ClassName>
+struct class_descriptor;
+
+} // namespace adk::reflect
+
+namespace adk::ecs
+{
+
+/**
+ * Storage options of a component type, specialize it to change them.
+ *
+ * With a page_size of 0 components are packed in a single vector, which is the
+ * fastest to iterate but moves every component when it grows. Otherwise they're
+ * stored in pages of page_size components that are never moved once allocated,
+ * so growing the pool doesn't copy anything and references returned by assign
+ * and get stay valid. Removing a component still moves the pool's last
+ * component into its place. page_size must be a power of two, pages of at least
+ * 4 KB are aligned to their size (up to 2 MB) so they can be backed by huge pages.
+ *
+ * With split_members, a type described by ADK_REFLECT_CLASS is stored as one
+ * array per reflected member instead, so loops that only need a few members
+ * don't pull the others into cache, see registry::columns. Every member must
+ * be reflected and the type must be default constructible. Such components
+ * are read by value with registry::get and written with registry::patch. In
+ * a view the type itself only filters entities and adk::ecs::members hands out
+ * references to some of its members. They can't be grouped, sorted with a
+ * comparison or optional in a view, and page_size is ignored. Specializations
+ * that leave split_members out don't split.
+ */
+template <typename T>
+struct component_traits
+{
+    static constexpr std::size_t page_size = 0;
+    static constexpr bool split_members = false;
+};
+
+} // namespace adk::ecs
+
 namespace adk::ecs::internal
 {
 
 // Constant values and types
 using DEFAULT_ENTITY_ID_TYPE = std::uint32_t;
 constexpr std::size_t MAX_COMPONENTS = 64;
+constexpr std::size_t SIGNATURE_BLOCK = 64;
+constexpr std::size_t PARALLEL_CHUNK_BYTES = 16 * 1024;
+constexpr std::size_t MIN_PARALLEL_CHUNK = 64;
+constexpr std::size_t INSERTION_SORT_MOVES = 8;
+// Most free slots set aside for registry::reserve_entity at once
+constexpr std::size_t RESERVED_SLOTS = 256;
+constexpr std::uint32_t SNAPSHOT_MAGIC = 0x534b4441; // "ADKS"
+constexpr std::uint32_t SNAPSHOT_VERSION = 2;
 
 /**
  * Returns index number from passed entity.
  */
 template <typename entity_id>
-entity_id get_entity_index(entity_id entity)
+constexpr entity_id get_entity_index(entity_id entity)
 {
     constexpr std::size_t index_offset = sizeof(entity_id) * 8 / 2;
     return entity >> index_offset;
@@ -52,17 +148,18 @@ entity_id get_entity_index(entity_id entity)
  * Returns version number from passed entity.
  */
 template <typename entity_id>
-entity_id get_entity_version(entity_id entity)
+constexpr entity_id get_entity_version(entity_id entity)
 {
     constexpr std::size_t version_size = sizeof(entity_id) * 8 / 2;
-    return (entity << version_size) >> version_size;
+    constexpr entity_id version_mask = (entity_id(1) << version_size) - 1;
+    return entity & version_mask;
 }
 
 /**
  * Returns new entity_id with passed index.
  */
 template <typename entity_id>
-entity_id set_entity_index(entity_id entity, entity_id index)
+constexpr entity_id set_entity_index(entity_id entity, entity_id index)
 {
     constexpr std::size_t index_offset = sizeof(entity_id) * 8 / 2;
     const auto version = get_entity_version(entity);
@@ -73,14 +170,15 @@ entity_id set_entity_index(entity_id entity, entity_id index)
 }
 
 /**
- * Returns new entity_id with passed version.
+ * Returns new entity_id with passed version, wrapping it if it doesn't fit.
  */
 template <typename entity_id>
-entity_id set_entity_version(entity_id entity, entity_id version)
+constexpr entity_id set_entity_version(entity_id entity, entity_id version)
 {
-    const auto index = get_entity_index(entity);
-    entity = version;
-    entity |= index;
+    constexpr std::size_t index_offset = sizeof(entity_id) * 8 / 2;
+    entity = get_entity_index(entity);
+    entity <<= index_offset;
+    entity |= get_entity_version(version);
     return entity;
 }
 
@@ -88,7 +186,7 @@ entity_id set_entity_version(entity_id entity, entity_id version)
  * Returns whether or not an entity is valid.
  */
 template <typename entity_id>
-bool entity_is_valid(entity_id entity)
+constexpr bool entity_is_valid(entity_id entity)
 {
     const entity_id invalid_entity = std::numeric_limits<entity_id>().max();
     return entity != invalid_entity;
@@ -98,7 +196,7 @@ bool entity_is_valid(entity_id entity)
  * Factory function for an entity id that is considered invalid.
  */
 template <typename entity_id>
-entity_id create_invalid_entity()
+constexpr entity_id create_invalid_entity()
 {
     return std::numeric_limits<entity_id>().max();
 }
@@ -107,437 +205,5711 @@ entity_id create_invalid_entity()
  * Returns a number unique to each time starting from 0 and incrementing
  * with each passed type.
  */
-static std::size_t current_component_id = 0;
+inline std::atomic<std::size_t> current_component_id = 0;
 template <typename T>
 std::size_t get_component_id()
 {
     static std::size_t id = current_component_id++;
-    ADK_ASSERT(id < 64);
     return id;
 }
 
 /**
- * Interface for component alloctors so they can be held generically.
+ * Same as get_component_id but for the parameter lists of instrumented queries.
  */
-template <typename entity_id>
-struct i_component_allocator
+inline std::atomic<std::size_t> current_query_id = 0;
+template <typename... Types>
+std::size_t get_query_id()
 {
-    virtual ~i_component_allocator() = default;
-    virtual void entity_destroyed(entity_id entity) = 0;
-};
+    static std::size_t id = current_query_id++;
+    return id;
+}
 
 /**
- * Type-specific component handler. Basically identical to component_manager but
- * doesn't deal with type_indexes and such, just acts directly on templated type.
+ * Same as get_component_id but for registry resources, kept apart so the
+ * resource table stays as small as the number of resource types.
  */
-template <typename entity_id, typename T>
-struct component_allocator : public i_component_allocator<entity_id>
+inline std::atomic<std::size_t> current_resource_id = 0;
+template <typename T>
+std::size_t get_resource_id()
 {
-    std::vector<T> arr;
-    
-    T& insert(entity_id entity, const T&& component)
+    static std::size_t id = current_resource_id++;
+    return id;
+}
+
+/**
+ * Returns the name of T as the compiler spells it, or an empty string on
+ * unknown compilers. Only meant for diagnostics.
+ */
+template <typename T>
+constexpr std::string_view type_name()
+{
+#if defined(__clang__) || defined(__GNUC__)
+    constexpr std::string_view name = __PRETTY_FUNCTION__;
+    constexpr std::size_t start = name.find("T = ") + 4;
+    constexpr std::size_t semicolon = name.find(';', start);
+    constexpr std::size_t end = semicolon != std::string_view::npos ? semicolon : name.rfind(']');
+    return name.substr(start, end - start);
+#elif defined(_MSC_VER)
+    constexpr std::string_view name = __FUNCSIG__;
+    constexpr std::size_t start = name.find("type_name<") + 10;
+    return name.substr(start, name.rfind(">(void)") - start);
+#else
+    return {};
+#endif
+}
+
+/**
+ * Empty component types are tags, they only exist as a signature bit and
+ * have no pool.
+ */
+template <typename T>
+constexpr bool is_tag = std::is_empty_v<T>;
+
+/**
+ * Shared instance handed out wherever a reference to a tag is expected.
+ */
+template <typename T>
+T& tag_instance()
+{
+    static T instance;
+    return instance;
+}
+
+/**
+ * Number of entries in each page of a sparse set's index. Pages are only
+ * allocated once an entity index inside of them is used.
+ */
+constexpr std::size_t SPARSE_PAGE_SIZE = 4096;
+
+/**
+ * Maps entity indexes to positions in a packed array of entities. The sparse
+ * side is paged so memory scales with the entity indexes actually in use rather
+ * than the highest one, and the packed side can be walked linearly.
+ */
+template <typename entity_id>
+struct sparse_set
+{
+    static constexpr entity_id tombstone = std::numeric_limits<entity_id>::max();
+
+    std::pmr::vector<entity_id> entities;
+    std::pmr::vector<entity_id*> sparse;
+
+    explicit sparse_set(std::pmr::memory_resource* resource)
+        : entities(resource),
+          sparse(resource)
+    {}
+
+    sparse_set(const sparse_set&) = delete;
+    sparse_set& operator=(const sparse_set&) = delete;
+
+    ~sparse_set()
     {
-        const auto index = get_entity_index(entity);
-        if (index >= arr.size()) {
-            arr.resize(index == 0 ? 32 : get_entity_index(entity) * 2);
-        };
-        arr[index] = component;
-        return arr[index];
+        for (const auto page : sparse) {
+            if (page != nullptr) {
+                resource()->deallocate(page, SPARSE_PAGE_SIZE * sizeof(entity_id), alignof(entity_id));
+            }
+        }
     }
 
-    T& get(entity_id entity)
+    /**
+     * Returns the memory resource everything in the set is allocated from.
+     */
+    std::pmr::memory_resource* resource() const
     {
-        const auto index = get_entity_index(entity);
-        ADK_ASSERT(arr.size() >= index);
-        return arr[index];
+        return entities.get_allocator().resource();
     }
 
-    void destroy(entity_id entity)
+    /**
+     * Returns whether or not the passed entity is in the set.
+     */
+    bool contains(entity_id entity) const
     {
-        const auto index = get_entity_index(entity);
-        ADK_ASSERT(arr.size() >= index);
-        arr[index] = T{};
+        const std::size_t index = get_entity_index(entity);
+        const std::size_t page = index / SPARSE_PAGE_SIZE;
+        return page < sparse.size() && sparse[page] 
+            && sparse[page][index % SPARSE_PAGE_SIZE] != tombstone;
     }
 
-    void entity_destroyed(entity_id entity) override
+    /**
+     * Returns the position of the passed entity in the packed array.
+     * Expects that the entity is in the set.
+     */
+    std::size_t index_of(entity_id entity) const
     {
-        destroy(entity); 
+        ADK_ASSERT(contains(entity));
+        const std::size_t index = get_entity_index(entity);
+        return sparse[index / SPARSE_PAGE_SIZE][index % SPARSE_PAGE_SIZE];
     }
-};
 
-/**
- * Handles all direct component interaction. Encapsulating class
- * for registry.
- */
-template <typename entity_id>
-class component_manager
-{
-public:
+    std::size_t size() const
+    {
+        return entities.size();
+    }
+
+protected:
     /**
-     * Adds component to passed entity and returns a reference to it.
+     * Appends entity to the packed array and returns its position.
      */
-    template <typename T>
-    T& insert(entity_id entity, const T&& component)
+    std::size_t push_entity(entity_id entity)
     {
-        const auto type_index = std::type_index(typeid(T));
-        
-        // If allocator doesn't exist for type, make one
-        if (allocators.find(type_index) == allocators.end()) {
-            allocators.insert({
-                type_index,
-                std::make_unique<component_allocator<entity_id, T>>(),
-            });
-        }
-
-        ADK_ASSERT(allocators.find(type_index) != allocators.end());
+        auto& slot = assure_slot(get_entity_index(entity));
+        ADK_ASSERT(slot == tombstone);
+        slot = static_cast<entity_id>(entities.size());
+        entities.push_back(entity);
+        return slot;
+    }
 
-        const auto allocator = static_cast<component_allocator<entity_id, T>*>(allocators[type_index].get());
-        return allocator->insert(entity, std::move(component));
+    /**
+     * Removes entity from the set by moving the last entity into its place.
+     */
+    void pop_entity(entity_id entity)
+    {
+        const std::size_t index = get_entity_index(entity);
+        auto& slot = sparse[index / SPARSE_PAGE_SIZE][index % SPARSE_PAGE_SIZE];
+        const auto last = entities.back();
+        const std::size_t last_index = get_entity_index(last);
+        entities[slot] = last;
+        sparse[last_index / SPARSE_PAGE_SIZE][last_index % SPARSE_PAGE_SIZE] = slot;
+        slot = tombstone;
+        entities.pop_back();
     }
-   
+
     /**
-     * Returns component associated with passed entity as reference.
+     * Points the sparse index at every entity of the packed array, used after
+     * it has been filled directly.
      */
-    template <typename T>
-    T& get(entity_id entity)
+    void index_entities()
     {
-        const auto type_index = std::type_index(typeid(T));
-        ADK_ASSERT(allocators.find(type_index) != allocators.end());
-        const auto allocator = static_cast<component_allocator<entity_id, T>*>(allocators[type_index].get());
-        return allocator->get(entity);
+        for (std::size_t i = 0; i < entities.size(); i++) {
+            assure_slot(get_entity_index(entities[i])) = static_cast<entity_id>(i);
+        }
     }
-    
+
     /**
-     * Destructs the specified component type that is associated with the passed entity.
+     * Removes every entity from the set, keeping allocated pages.
      */
-    template <typename T>
-    void destroy(entity_id entity)
+    void clear_entities()
     {
-        const auto type_index = std::type_index(typeid(T));
-        ADK_ASSERT(allocators.find(type_index) != allocators.end());
-        const auto allocator = static_cast<component_allocator<entity_id, T>*>(allocators[type_index].get());
-        return allocator->destroy(entity);
+        for (const auto entity : entities) {
+            const std::size_t index = get_entity_index(entity);
+            sparse[index / SPARSE_PAGE_SIZE][index % SPARSE_PAGE_SIZE] = tombstone;
+        }
+        entities.clear();
     }
-    
+
     /**
-     * Destructs all components associated with specified entity
+     * Frees sparse pages that no entity of the set falls in and shrinks the
+     * arrays to their size.
      */
-    void entity_destroyed(entity_id entity)
+    void shrink_entities()
     {
-        for (auto& [_, allocator] : allocators) {
-            allocator->entity_destroyed(entity);
+        for (auto& page : sparse) {
+            if (page != nullptr && std::all_of(page, page + SPARSE_PAGE_SIZE, [](entity_id slot) { return slot == tombstone; })) {
+                resource()->deallocate(page, SPARSE_PAGE_SIZE * sizeof(entity_id), alignof(entity_id));
+                page = nullptr;
+            }
         }
+        while (!sparse.empty() && sparse.back() == nullptr) {
+            sparse.pop_back();
+        }
+        sparse.shrink_to_fit();
+        entities.shrink_to_fit();
+    }
+
+    /**
+     * Swaps the entities at two positions of the packed array.
+     */
+    void swap_entities(std::size_t a, std::size_t b)
+    {
+        const std::size_t index_a = get_entity_index(entities[a]);
+        const std::size_t index_b = get_entity_index(entities[b]);
+        std::swap(entities[a], entities[b]);
+        sparse[index_a / SPARSE_PAGE_SIZE][index_a % SPARSE_PAGE_SIZE] = static_cast<entity_id>(b);
+        sparse[index_b / SPARSE_PAGE_SIZE][index_b % SPARSE_PAGE_SIZE] = static_cast<entity_id>(a);
     }
 
 private:
-    std::unordered_map<std::type_index, std::unique_ptr<i_component_allocator<entity_id>>> allocators;
+    entity_id& assure_slot(std::size_t index)
+    {
+        const std::size_t page = index / SPARSE_PAGE_SIZE;
+        if (page >= sparse.size()) {
+            sparse.resize(page + 1);
+        }
+        if (sparse[page] == nullptr) {
+            const auto memory = resource()->allocate(SPARSE_PAGE_SIZE * sizeof(entity_id), alignof(entity_id));
+            sparse[page] = static_cast<entity_id*>(memory);
+            std::fill_n(sparse[page], SPARSE_PAGE_SIZE, tombstone);
+        }
+        return sparse[page][index % SPARSE_PAGE_SIZE];
+    }
 };
 
 /**
- * Internal entity representation, contains a mask to easily iterate over them
+ * Vector-like container that stores its elements in fixed-size pages, elements
+ * never move when it grows. Only supports what component pools need.
  */
-template <typename entity_id>
-struct entity
+template <typename T, std::size_t page_size>
+class paged_storage
 {
-    entity_id id;
-    std::uint64_t mask = 0;
-};
-
-/**
- * Tuple type concatenation
- */
-template <typename... Tuples>
-struct tuple_cat_s;
+    static_assert(std::has_single_bit(page_size), "Page size must be a power of two");
 
-/**
- * Recursive case, combine both tuple types and call again with new one
- * and other types
- */
-template <typename... Ts, typename... Us, typename... Tuples>
-struct tuple_cat_s<std::tuple<Ts...>, std::tuple<Us...>, Tuples...>
-    : tuple_cat_s<std::tuple<Ts..., Us...>, Tuples...> {};
+public:
+    explicit paged_storage(std::pmr::memory_resource* resource)
+        : pages(resource)
+    {}
 
-/**
- * Base case, simple tuple without any nested
- */
-template <typename... Ts>
-struct tuple_cat_s<std::tuple<Ts...>> 
-{
-    using type = std::tuple<Ts...>;
-};
+    paged_storage(const paged_storage&) = delete;
+    paged_storage& operator=(const paged_storage&) = delete;
 
-/**
- * Alias for tuple_cat_s::type for ease of use
- */
-template <typename... Tuples>
-using tuple_cat_t = typename tuple_cat_s<Tuples...>::type;
+    ~paged_storage()
+    {
+        clear();
+        for (const auto page : pages) {
+            pages.get_allocator().resource()->deallocate(page, page_bytes, page_alignment);
+        }
+    }
 
-/**
- * Base case for generating a reference tuple
- */
-template <typename... Types>
-struct make_view_tuple 
-{
-    using type = std::tuple<>;
-};
+    T& operator[](std::size_t index)
+    {
+        return pages[index / page_size][index % page_size];
+    }
 
-/**
- * Recursive case
- */
-template <typename T, typename... Types>
-struct make_view_tuple<T, Types...> 
-{
-    using type = tuple_cat_t<std::tuple<T&>, typename make_view_tuple<Types...>::type>;
-};
+    const T& operator[](std::size_t index) const
+    {
+        return pages[index / page_size][index % page_size];
+    }
 
-/**
- * Turns the passed parameter pack of types into a tuple type with the same types
- * but as references
- */
-template <typename entity_id, typename... Types>
-using view_tuple = tuple_cat_t<std::tuple<entity_id>, typename make_view_tuple<Types...>::type>;
+    T& back()
+    {
+        return (*this)[count - 1];
+    }
 
-} // namespace adk::ecs::internal
+    std::size_t size() const
+    {
+        return count;
+    }
 
-// Public interface
-namespace adk::ecs
-{
+    std::size_t capacity() const
+    {
+        return pages.size() * page_size;
+    }
 
-/**
- * Monolothic ECS registry, handles creating and destroying entities
- * as well as manipulating them with components. The template parameter
- * specifies the underlying type for an entity id. Half of the bits will
- * be used as an index and the other half will be used as versioning.
- *
- * Ex. if you have adk::registry<std::uint32_t> then the index is 16 bits
- * and the version is 16 bits. This means you can have a maximum of 2^16 entities.
- */
-template <typename entity_id = internal::DEFAULT_ENTITY_ID_TYPE>
-class registry
-{
-private:
-    internal::component_manager<entity_id> component_manager;
-    std::vector<internal::entity<entity_id>> entities;
-    std::queue<entity_id> deleted_ids;
-    entity_id current_index = 0;
-    
     /**
-     * Iterator for a registry that takes in types as a template parameter and will
-     * return all components for each entity that possesses all parameter types
-     * as components. Should only be created via factory function.
+     * Allocates pages until capacity elements fit.
      */
-    template <typename... Types>
-    class view
+    void reserve(std::size_t capacity)
     {
-    public:
-        view(registry& reg)
-            : reg(reg)
-        {
-            (add_type_to_mask<Types>(),...);
-            find_next_valid();
+        while (pages.size() * page_size < capacity) {
+            const auto page = pages.get_allocator().resource()->allocate(page_bytes, page_alignment);
+            pages.push_back(static_cast<T*>(page));
         }
+    }
 
-        using tuple = internal::view_tuple<entity_id, Types...>;
-        using iterator_category = std::forward_iterator_tag;
-        using value_type = tuple;
+    template <typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        reserve(count + 1);
+        const auto element = new (&(*this)[count]) T(std::forward<Args>(args)...);
+        count++;
+        return *element;
+    }
 
-        value_type operator*() const 
-        {
-            value_type tuple = { reg.entities[current_index].id, reg.get<Types>(reg.entities[current_index].id)... };
-            return tuple;
-        };
+    void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
 
-        value_type operator->() const 
-        { 
-            value_type tuple = { reg.entities[current_index].id, reg.get<Types>(reg.entities[current_index].id)... };
-            return tuple;
-        }
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
 
-        view<Types...>& operator++()
-        {
-            find_next_valid();
-            return *this;
-        }
+    void pop_back()
+    {
+        back().~T();
+        count--;
+    }
 
-        view<Types...>& operator+=(int i)
-        {
-            for (int j = 0; j < i; j++) {
-                find_next_valid();
-            }
-            return *this;
+    void clear()
+    {
+        while (count > 0) {
+            pop_back();
         }
+    }
 
-        friend bool operator==(const view& a, const view& b) 
-        { 
-            return a.current_index == b.current_index; 
+    /**
+     * Frees the pages past the last element.
+     */
+    void shrink_to_fit()
+    {
+        const std::size_t used = (count + page_size - 1) / page_size;
+        while (pages.size() > used) {
+            pages.get_allocator().resource()->deallocate(pages.back(), page_bytes, page_alignment);
+            pages.pop_back();
         }
+        pages.shrink_to_fit();
+    }
 
-        friend bool operator!=(const view& a, const view& b) 
-        { 
-            return a.current_index != b.current_index; 
-        }
+private:
+    static constexpr std::size_t page_bytes = page_size * sizeof(T);
+    static constexpr std::size_t page_alignment = std::max(alignof(T),
+        page_bytes >= 4096 ? std::min(std::bit_floor(page_bytes), std::size_t(2 * 1024 * 1024)) : alignof(T));
+
+    std::pmr::vector<T*> pages;
+    std::size_t count = 0;
+};
+
+template <typename T>
+concept split_component = requires { requires component_traits<T>::split_members; };
+
+/**
+ * Type of the reflected member of T at index, in declaration order.
+ */
+template <typename T, std::size_t index>
+using column_t = typename std::tuple_element_t<index, typename adk::reflect::class_descriptor<T>::members>::type;
+
+/**
+ * Stores each reflected member of T in its own array, all of them indexed the
+ * same way. Components are taken apart on insertion and put back together by
+ * value in get.
+ */
+template <typename T, typename Members = typename adk::reflect::class_descriptor<T>::members>
+class column_storage;
+
+template <typename T, typename... Members>
+class column_storage<T, std::tuple<Members...>>
+{
+    static_assert(sizeof...(Members) > 0, "Split components need at least one reflected member");
+    static_assert(std::is_default_constructible_v<T>, "Split components must be default constructible");
+
+public:
+    explicit column_storage(std::pmr::memory_resource* resource)
+        : columns(std::pmr::vector<typename Members::type>(resource)...)
+    {}
+
+    template <std::size_t index>
+    auto& column()
+    {
+        return std::get<index>(columns);
+    }
+
+    template <std::size_t index>
+    const auto& column() const
+    {
+        return std::get<index>(columns);
+    }
+
+    /**
+     * Calls func with every column.
+     */
+    template <typename Func>
+    void for_each_column(Func func)
+    {
+        std::apply([&func](auto&... column) { (func(column), ...); }, columns);
+    }
+
+    template <typename Func>
+    void for_each_column(Func func) const
+    {
+        std::apply([&func](const auto&... column) { (func(column), ...); }, columns);
+    }
+
+    std::size_t size() const
+    {
+        return std::get<0>(columns).size();
+    }
+
+    std::size_t capacity() const
+    {
+        return std::get<0>(columns).capacity();
+    }
+
+    /**
+     * Returns bytes reserved by all of the columns.
+     */
+    std::size_t memory_bytes() const
+    {
+        std::size_t bytes = 0;
+        for_each_column([&bytes](const auto& column) {
+            bytes += column.capacity() * sizeof(column[0]);
+        });
+        return bytes;
+    }
+
+    void reserve(std::size_t capacity)
+    {
+        for_each_column([capacity](auto& column) { column.reserve(capacity); });
+    }
+
+    void push_back(const T& value)
+    {
+        for_each_member([this, &value](auto index) {
+            std::get<index>(columns).push_back(member<index>(value));
+        });
+    }
+
+    void push_back(T&& value)
+    {
+        for_each_member([this, &value](auto index) {
+            std::get<index>(columns).push_back(std::move(member<index>(value)));
+        });
+    }
+
+    T get(std::size_t index) const
+    {
+        T value{};
+        set_members(value, index);
+        return value;
+    }
+
+    /**
+     * Copies the members of value into the component at index.
+     */
+    template <typename Arg>
+    void set(std::size_t index, Arg&& value)
+    {
+        for_each_member([this, index, &value](auto member_index) {
+            if constexpr (std::is_rvalue_reference_v<Arg&&>) {
+                std::get<member_index>(columns)[index] = std::move(member<member_index>(value));
+            } else {
+                std::get<member_index>(columns)[index] = member<member_index>(value);
+            }
+        });
+    }
+
+    void swap(std::size_t a, std::size_t b)
+    {
+        for_each_column([a, b](auto& column) {
+            using std::swap;
+            swap(column[a], column[b]);
+        });
+    }
+
+    /**
+     * Moves the last component into index and shrinks the columns by one.
+     */
+    void swap_remove(std::size_t index)
+    {
+        for_each_column([index](auto& column) {
+            if (index != column.size() - 1) {
+                column[index] = std::move(column.back());
+            }
+            column.pop_back();
+        });
+    }
+
+    void clear()
+    {
+        for_each_column([](auto& column) { column.clear(); });
+    }
+
+    void shrink_to_fit()
+    {
+        for_each_column([](auto& column) { column.shrink_to_fit(); });
+    }
+
+private:
+    std::tuple<std::pmr::vector<typename Members::type>...> columns;
+
+    template <typename Func>
+    static void for_each_member(Func func)
+    {
+        [&func]<std::size_t... indexes>(std::index_sequence<indexes...>) {
+            (func(std::integral_constant<std::size_t, indexes>()), ...);
+        }(std::index_sequence_for<Members...>());
+    }
+
+    template <std::size_t index, typename U>
+    static auto& member(U& value)
+    {
+        using member_type = std::tuple_element_t<index, std::tuple<Members...>>;
+        using type = std::conditional_t<std::is_const_v<U>, const typename member_type::type, typename member_type::type>;
+        return *reinterpret_cast<type*>(reinterpret_cast<std::conditional_t<std::is_const_v<U>, const std::byte, std::byte>*>(
+            std::addressof(value)) + member_type::offset);
+    }
+
+    void set_members(T& value, std::size_t index) const
+    {
+        for_each_member([this, index, &value](auto member_index) {
+            member<member_index>(value) = std::get<member_index>(columns)[index];
+        });
+    }
+};
+
+/**
+ * Picks the container of a component type, split types get a column_storage.
+ */
+template <typename T, bool split = split_component<T>>
+struct storage_for
+{
+    using type = std::conditional_t<component_traits<T>::page_size == 0,
+        std::pmr::vector<T>, paged_storage<T, component_traits<T>::page_size>>;
+};
+
+template <typename T>
+struct storage_for<T, true>
+{
+    using type = column_storage<T>;
+};
+
+/**
+ * Container a pool keeps its components in, see component_traits.
+ */
+template <typename T>
+using component_storage = typename storage_for<T>::type;
+
+/**
+ * Deleter for objects allocated from a memory resource.
+ */
+template <typename T>
+struct resource_deleter
+{
+    std::pmr::memory_resource* resource = nullptr;
+
+    void operator()(T* object) const
+    {
+        std::pmr::polymorphic_allocator<T>(resource).delete_object(object);
+    }
+};
+
+template <typename T>
+using resource_ptr = std::unique_ptr<T, resource_deleter<T>>;
+
+/**
+ * Constructs a T in memory allocated from resource.
+ */
+template <typename T, typename... Args>
+resource_ptr<T> make_resource_ptr(std::pmr::memory_resource* resource, Args&&... args)
+{
+    std::pmr::polymorphic_allocator<T> allocator(resource);
+    return resource_ptr<T>(allocator.template new_object<T>(std::forward<Args>(args)...), { resource });
+}
+
+/**
+ * Whether or not T has reflection metadata from adk_reflect.hpp.
+ */
+template <typename T>
+concept reflected_component = requires { sizeof(adk::reflect::class_descriptor<T>); };
+
+/**
+ * Sinks and sources for registry snapshots.
+ */
+struct buffer_writer
+{
+    std::vector<std::byte>& buffer;
+
+    void write(const void* data, std::size_t size)
+    {
+        const auto bytes = static_cast<const std::byte*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+};
+
+struct stream_writer
+{
+    std::ostream& stream;
+
+    void write(const void* data, std::size_t size)
+    {
+        stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+};
+
+struct buffer_reader
+{
+    std::span<const std::byte> data;
+    std::size_t position = 0;
+
+    bool read(void* out, std::size_t size)
+    {
+        if (data.size() - position < size) {
+            return false;
+        }
+        if (size > 0) {
+            std::memcpy(out, data.data() + position, size);
+        }
+        position += size;
+        return true;
+    }
+
+    /**
+     * Number of bytes left, counts are checked against it before anything is
+     * allocated for them.
+     */
+    std::size_t remaining() const
+    {
+        return data.size() - position;
+    }
+};
+
+struct stream_reader
+{
+    std::istream& stream;
+
+    bool read(void* out, std::size_t size)
+    {
+        return static_cast<bool>(stream.read(static_cast<char*>(out), static_cast<std::streamsize>(size)));
+    }
+
+    /**
+     * Number of bytes left, or as many as could be asked for if the stream
+     * can't seek.
+     */
+    std::size_t remaining()
+    {
+        const auto position = stream.tellg();
+        if (position == std::istream::pos_type(-1) || !stream.seekg(0, std::ios::end)) {
+            stream.clear();
+            return std::numeric_limits<std::size_t>::max();
+        }
+        const auto end = stream.tellg();
+        stream.seekg(position);
+        return static_cast<std::size_t>(end - position);
+    }
+};
+
+template <typename Writer, typename T>
+void write_component(Writer& writer, const T& component);
+
+template <typename Reader, typename T>
+bool read_component(Reader& reader, T& component);
+
+template <typename Writer, typename T, typename... Members>
+void write_members(Writer& writer, const T& component, std::tuple<Members...>*)
+{
+    const auto base = reinterpret_cast<const std::byte*>(std::addressof(component));
+    (write_component(writer, *reinterpret_cast<const typename Members::type*>(base + Members::offset)), ...);
+}
+
+template <typename Reader, typename T, typename... Members>
+bool read_members(Reader& reader, T& component, std::tuple<Members...>*)
+{
+    const auto base = reinterpret_cast<std::byte*>(std::addressof(component));
+    return (read_component(reader, *reinterpret_cast<typename Members::type*>(base + Members::offset)) && ...);
+}
+
+/**
+ * Writes a value as raw bytes if it's trivially copyable, otherwise member by
+ * member through its reflection metadata.
+ */
+template <typename Writer, typename T>
+void write_component(Writer& writer, const T& component)
+{
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        writer.write(std::addressof(component), sizeof(T));
+    } else {
+        static_assert(reflected_component<T>, "Snapshot types must be trivially copyable or reflected");
+        using members = typename adk::reflect::class_descriptor<T>::members;
+        write_members(writer, component, static_cast<members*>(nullptr));
+    }
+}
+
+template <typename Reader, typename T>
+bool read_component(Reader& reader, T& component)
+{
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        return reader.read(std::addressof(component), sizeof(T));
+    } else {
+        static_assert(reflected_component<T>, "Snapshot types must be trivially copyable or reflected");
+        using members = typename adk::reflect::class_descriptor<T>::members;
+        return read_members(reader, component, static_cast<members*>(nullptr));
+    }
+}
+
+/**
+ * State shared with threads reserving entity ids, see registry::reserve_entity.
+ * Free slots are handed out of a ring that only the registry's own thread
+ * stocks, positions only ever grow so a stale compare exchange on head can't
+ * succeed. Once the ring is empty indexes past every one in use are claimed.
+ */
+template <typename entity_id>
+struct reservation_state
+{
+    std::array<std::atomic<entity_id>, RESERVED_SLOTS> slots{};
+    // Next position to hand out and one past the last stocked position
+    alignas(64) std::atomic<std::uint64_t> head = 0;
+    alignas(64) std::atomic<std::uint64_t> tail = 0;
+    // Lowest entity index that has never been handed out
+    alignas(64) std::atomic<std::size_t> next_index = 0;
+    // Indexes below trimmed_end were trimmed by registry::compact at some point
+    // and come back with trimmed_version, which is at least the next version
+    // every one of them had, so old ids of those slots stay invalid
+    std::atomic<std::size_t> trimmed_end = 0;
+    std::atomic<entity_id> trimmed_version = 0;
+};
+
+/**
+ * Values of registry resources indexed by resource id, each allocated on its
+ * own from the registry's memory so references to it stay valid while other
+ * resources are added.
+ */
+class resource_table
+{
+public:
+    struct slot
+    {
+        void* value = nullptr;
+        void (*destroy)(std::pmr::memory_resource*, void*) = nullptr;
+    };
+
+    explicit resource_table(std::pmr::memory_resource* resource)
+        : slots(resource)
+    {}
+
+    resource_table(resource_table&& other) noexcept
+        : slots(std::move(other.slots))
+    {
+        other.slots.clear();
+    }
+
+    resource_table& operator=(resource_table&&) = delete;
+
+    ~resource_table()
+    {
+        for (const auto& slot : slots) {
+            erase(slot);
+        }
+    }
+
+    void* find(std::size_t id) const
+    {
+        return id < slots.size() ? slots[id].value : nullptr;
+    }
+
+    /**
+     * Constructs a new value at id, then destroys the one it replaces if any.
+     * The arguments can refer to the old value, and it's kept if the
+     * constructor throws.
+     */
+    template <typename T, typename... Args>
+    T& emplace(std::size_t id, Args&&... args)
+    {
+        if (id >= slots.size()) {
+            slots.resize(id + 1);
+        }
+        const auto resource = slots.get_allocator().resource();
+        void* value = resource->allocate(sizeof(T), alignof(T));
+#ifdef ADK_ECS_EXCEPTIONS
+        try {
+            new (value) T(std::forward<Args>(args)...);
+        } catch (...) {
+            resource->deallocate(value, sizeof(T), alignof(T));
+            throw;
+        }
+#else
+        new (value) T(std::forward<Args>(args)...);
+#endif
+        erase(std::exchange(slots[id], { value, [](std::pmr::memory_resource* resource, void* value) {
+                                             static_cast<T*>(value)->~T();
+                                             resource->deallocate(value, sizeof(T), alignof(T));
+                                         } }));
+        return *static_cast<T*>(value);
+    }
+
+    void erase(std::size_t id)
+    {
+        if (id < slots.size()) {
+            erase(std::exchange(slots[id], {}));
+        }
+    }
+
+private:
+    std::pmr::vector<slot> slots;
+
+    void erase(const slot& slot)
+    {
+        if (slot.value != nullptr) {
+            slot.destroy(slots.get_allocator().resource(), slot.value);
+        }
+    }
+};
+
+template <typename entity_id>
+struct group_handler;
+
+/**
+ * Interface for component alloctors so they can be held generically.
+ */
+template <typename entity_id>
+struct i_component_allocator : public sparse_set<entity_id>
+{
+    /**
+     * Change state of a component when tracking is enabled, each field is one past
+     * the entity's position in the matching dirty list, or 0 if it isn't in it.
+     * An entity can end up in a list more than once if it was removed and added
+     * again, only the entry the state points to counts.
+     */
+    struct change_state
+    {
+        std::uint32_t added = 0;
+        std::uint32_t changed = 0;
+    };
+
+    // Group that keeps its members packed at the front of this pool, if any
+    group_handler<entity_id>* owner = nullptr;
+    // Component type name for diagnostics
+    std::string_view name;
+
+    // Change tracking, changes is parallel to the packed arrays when enabled
+    bool tracking = false;
+    std::pmr::vector<change_state> changes;
+    std::pmr::vector<entity_id> added_entities;
+    std::pmr::vector<entity_id> changed_entities;
+    std::pmr::vector<entity_id> removed_entities;
+
+    // Set whenever the pool may have been written to, including through
+    // references handed out by views and get, see consume_writes
+    std::atomic<bool> written = true;
+    std::uint64_t write_version = 0;
+
+    explicit i_component_allocator(std::pmr::memory_resource* resource)
+        : sparse_set<entity_id>(resource),
+          changes(resource),
+          added_entities(resource),
+          changed_entities(resource),
+          removed_entities(resource)
+    {}
+
+    virtual ~i_component_allocator() = default;
+    virtual void entity_destroyed(entity_id entity) = 0;
+    virtual void swap_positions(std::size_t a, std::size_t b) = 0;
+
+    /**
+     * Destroys the allocator and frees it back to the resource it came from.
+     */
+    virtual void dispose() = 0;
+
+    /**
+     * Removes every component without notifying the owning group and forgets
+     * recorded changes.
+     */
+    virtual void clear() = 0;
+
+    /**
+     * Returns number of components the pool can hold without allocating.
+     */
+    virtual std::size_t capacity() const = 0;
+
+    /**
+     * Gives back memory the pool doesn't need for the components it holds.
+     */
+    virtual void shrink() = 0;
+
+    /**
+     * Returns number of bytes allocated by the pool, not counting the allocator
+     * object itself.
+     */
+    virtual std::size_t memory_bytes() const = 0;
+
+    /**
+     * Can be called from any thread that is allowed to write the pool.
+     */
+    void mark_written()
+    {
+        // Checked first so that threads sharing a pool don't keep taking the
+        // cache line from each other
+        if (!written.load(std::memory_order_relaxed)) {
+            written.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Returns a number that changes whenever the pool is written to, as long as
+     * it's called between writes. Consumers that kept the number from their last
+     * copy of the pool can skip copying it again while it matches.
+     */
+    std::uint64_t consume_writes()
+    {
+        if (written.exchange(false, std::memory_order_relaxed)) {
+            write_version++;
+        }
+        return write_version;
+    }
+
+    void enable_tracking()
+    {
+        if (!tracking) {
+            tracking = true;
+            changes.assign(this->size(), {});
+        }
+    }
+
+    /**
+     * Marks the component of the passed entity as modified.
+     */
+    void mark_changed(entity_id entity)
+    {
+        if (!tracking) {
+            return;
+        }
+        auto& state = changes[this->index_of(entity)];
+        if (state.changed == 0) {
+            changed_entities.push_back(entity);
+            state.changed = static_cast<std::uint32_t>(changed_entities.size());
+        }
+    }
+
+    /**
+     * Returns whether or not entry position of a dirty list is current.
+     */
+    bool is_added(entity_id entity, std::size_t position) const
+    {
+        return is_current(entity) && changes[this->index_of(entity)].added == position + 1;
+    }
+
+    bool is_changed(entity_id entity, std::size_t position) const
+    {
+        return is_current(entity) && changes[this->index_of(entity)].changed == position + 1;
+    }
+
+    bool is_added(entity_id entity) const
+    {
+        return tracking && is_current(entity) && changes[this->index_of(entity)].added != 0;
+    }
+
+    bool is_changed(entity_id entity) const
+    {
+        return tracking && is_current(entity) && changes[this->index_of(entity)].changed != 0;
+    }
+
+    /**
+     * Forgets every recorded addition, modification and removal.
+     */
+    void clear_changes()
+    {
+        for (const auto entity : added_entities) {
+            if (is_current(entity)) {
+                changes[this->index_of(entity)].added = 0;
+            }
+        }
+        for (const auto entity : changed_entities) {
+            if (is_current(entity)) {
+                changes[this->index_of(entity)].changed = 0;
+            }
+        }
+        added_entities.clear();
+        changed_entities.clear();
+        removed_entities.clear();
+    }
+
+protected:
+    void track_insert(entity_id entity)
+    {
+        if (tracking) {
+            added_entities.push_back(entity);
+            changes.push_back({ static_cast<std::uint32_t>(added_entities.size()), 0 });
+        }
+    }
+
+    /**
+     * Called before the component at position is removed, mirrors the swap with
+     * the last component.
+     */
+    void track_remove(entity_id entity, std::size_t position)
+    {
+        if (tracking) {
+            changes[position] = changes.back();
+            changes.pop_back();
+            removed_entities.push_back(entity);
+        }
+    }
+
+    void track_swap(std::size_t a, std::size_t b)
+    {
+        if (tracking) {
+            std::swap(changes[a], changes[b]);
+        }
+    }
+
+private:
+    /**
+     * Whether or not the entity is in the pool with the same version.
+     */
+    bool is_current(entity_id entity) const
+    {
+        return this->contains(entity) && this->entities[this->index_of(entity)] == entity;
+    }
+};
+
+/**
+ * State of an owning group. Entities that have every owned component are kept
+ * at positions [0, length) of every owned pool, in the same order, so iterating
+ * the group walks all of the pools in lockstep.
+ */
+template <typename entity_id>
+struct group_handler
+{
+    std::pmr::vector<i_component_allocator<entity_id>*> pools;
+    std::size_t length = 0;
+
+    explicit group_handler(std::pmr::memory_resource* resource)
+        : pools(resource)
+    {}
+
+    /**
+     * Called once a component was added to an owned pool, moves the entity
+     * into the group if it now has every owned component.
+     */
+    void on_construct(entity_id entity)
+    {
+        for (const auto pool : pools) {
+            if (!pool->contains(entity)) {
+                return;
+            }
+        }
+        if (pools[0]->index_of(entity) < length) {
+            return;
+        }
+        for (const auto pool : pools) {
+            pool->swap_positions(pool->index_of(entity), length);
+        }
+        length++;
+    }
+
+    /**
+     * Called before a component is removed from an owned pool, moves the entity
+     * out of the group if it was a member.
+     */
+    void on_destroy(entity_id entity)
+    {
+        for (const auto pool : pools) {
+            if (!pool->contains(entity)) {
+                return;
+            }
+        }
+        if (pools[0]->index_of(entity) >= length) {
+            return;
+        }
+        length--;
+        for (const auto pool : pools) {
+            pool->swap_positions(pool->index_of(entity), length);
+        }
+    }
+};
+
+/**
+ * Type-specific component handler. Basically identical to component_manager but
+ * doesn't deal with type_indexes and such, just acts directly on templated type.
+ *
+ * Components are packed in arr in the same order as the entities array of the
+ * underlying sparse set, removals swap the last component into the hole.
+ */
+template <typename entity_id, typename T>
+struct component_allocator : public i_component_allocator<entity_id>
+{
+    static constexpr bool split = split_component<T>;
+
+    component_storage<T> arr;
+
+    explicit component_allocator(std::pmr::memory_resource* resource)
+        : i_component_allocator<entity_id>(resource),
+          arr(resource)
+    {}
+    
+    /**
+     * Returns a reference to the new component, split components have none to
+     * return.
+     */
+    template <typename Arg>
+    decltype(auto) insert(entity_id entity, Arg&& component)
+    {
+        this->mark_written();
+        this->push_entity(entity);
+        arr.push_back(std::forward<Arg>(component));
+        this->track_insert(entity);
+        if constexpr (split) {
+            return;
+        } else {
+            if (this->owner != nullptr) {
+                this->owner->on_construct(entity);
+                return get(entity);
+            }
+            return arr.back();
+        }
+    }
+
+    /**
+     * Adds a copy of component to every passed entity.
+     */
+    void insert_n(std::span<const entity_id> entities, const T& component)
+    {
+        this->mark_written();
+        arr.reserve(arr.size() + entities.size());
+        this->entities.reserve(this->entities.size() + entities.size());
+        for (const auto entity : entities) {
+            this->push_entity(entity);
+            arr.push_back(component);
+            this->track_insert(entity);
+            if (this->owner != nullptr) {
+                this->owner->on_construct(entity);
+            }
+        }
+    }
+
+    /**
+     * Returns a reference to the entity's component, or a copy of it for split
+     * components.
+     */
+    decltype(auto) get(entity_id entity)
+    {
+        if constexpr (split) {
+            return arr.get(this->index_of(entity));
+        } else {
+            return arr[this->index_of(entity)];
+        }
+    }
+
+    decltype(auto) get(entity_id entity) const
+    {
+        if constexpr (split) {
+            return arr.get(this->index_of(entity));
+        } else {
+            return arr[this->index_of(entity)];
+        }
+    }
+
+    void destroy(entity_id entity)
+    {
+        if (this->owner != nullptr) {
+            this->owner->on_destroy(entity);
+        }
+        const auto index = this->index_of(entity);
+        this->mark_written();
+        this->track_remove(entity, index);
+        if constexpr (split) {
+            arr.swap_remove(index);
+        } else {
+            if (index != arr.size() - 1) {
+                arr[index] = std::move(arr.back());
+            }
+            arr.pop_back();
+        }
+        this->pop_entity(entity);
+    }
+
+    void entity_destroyed(entity_id entity) override
+    {
+        if (this->contains(entity)) {
+            destroy(entity); 
+        }
+    }
+
+    void swap_positions(std::size_t a, std::size_t b) override
+    {
+        if (a != b) {
+            this->mark_written();
+            if constexpr (split) {
+                arr.swap(a, b);
+            } else {
+                std::swap(arr[a], arr[b]);
+            }
+            this->swap_entities(a, b);
+            this->track_swap(a, b);
+        }
+    }
+
+    void dispose() override
+    {
+        std::pmr::polymorphic_allocator<component_allocator> allocator(this->resource());
+        allocator.delete_object(this);
+    }
+
+    std::size_t capacity() const override
+    {
+        return arr.capacity();
+    }
+
+    void shrink() override
+    {
+        arr.shrink_to_fit();
+        this->shrink_entities();
+        this->changes.shrink_to_fit();
+        this->added_entities.shrink_to_fit();
+        this->changed_entities.shrink_to_fit();
+        this->removed_entities.shrink_to_fit();
+    }
+
+    std::size_t memory_bytes() const override
+    {
+        std::size_t pages = 0;
+        for (const auto page : this->sparse) {
+            pages += page != nullptr;
+        }
+        std::size_t component_bytes = 0;
+        if constexpr (split) {
+            component_bytes = arr.memory_bytes();
+        } else {
+            component_bytes = arr.capacity() * sizeof(T);
+        }
+        return component_bytes
+            + this->entities.capacity() * sizeof(entity_id)
+            + this->sparse.capacity() * sizeof(entity_id*)
+            + pages * SPARSE_PAGE_SIZE * sizeof(entity_id)
+            + this->changes.capacity() * sizeof(typename i_component_allocator<entity_id>::change_state)
+            + (this->added_entities.capacity() + this->changed_entities.capacity()
+                + this->removed_entities.capacity()) * sizeof(entity_id);
+    }
+
+    void clear() override
+    {
+        this->mark_written();
+        arr.clear();
+        this->clear_entities();
+        this->changes.clear();
+        this->added_entities.clear();
+        this->changed_entities.clear();
+        this->removed_entities.clear();
+    }
+
+    /**
+     * Writes the number of components, the packed entity array and then the
+     * components, trivially copyable ones as a single block when possible.
+     * Split components are written a column at a time.
+     */
+    template <typename Writer>
+    void save(Writer& writer) const
+    {
+        const std::uint64_t count = arr.size();
+        writer.write(&count, sizeof(count));
+        writer.write(this->entities.data(), count * sizeof(entity_id));
+        if constexpr (split) {
+            arr.for_each_column([&writer](const auto& column) {
+                if constexpr (std::is_trivially_copyable_v<std::decay_t<decltype(column[0])>>) {
+                    writer.write(column.data(), column.size() * sizeof(column[0]));
+                } else {
+                    for (const auto& value : column) {
+                        write_component(writer, value);
+                    }
+                }
+            });
+        } else if constexpr (std::is_trivially_copyable_v<T> && std::is_same_v<component_storage<T>, std::pmr::vector<T>>) {
+            writer.write(arr.data(), count * sizeof(T));
+        } else {
+            for (std::size_t i = 0; i < count; i++) {
+                write_component(writer, arr[i]);
+            }
+        }
+    }
+
+    /**
+     * Reads what save wrote into the pool, which must be empty. Every entity is
+     * passed to accept before it's indexed. Returns false if the reader ran out
+     * of data or accept rejected an entity.
+     */
+    template <typename Reader, typename Accept>
+    bool load(Reader& reader, Accept&& accept)
+    {
+        static_assert(std::is_default_constructible_v<T>, "Restored component types must be default constructible");
+        this->mark_written();
+        std::uint64_t count = 0;
+        if (!reader.read(&count, sizeof(count)) || count > reader.remaining() / sizeof(entity_id)) {
+            return false;
+        }
+        this->entities.resize(count);
+        if (!reader.read(this->entities.data(), count * sizeof(entity_id))
+                || !std::all_of(this->entities.begin(), this->entities.end(), accept)) {
+            this->entities.clear();
+            return false;
+        }
+        this->index_entities();
+        if constexpr (split) {
+            bool complete = true;
+            arr.for_each_column([&reader, &complete, count](auto& column) {
+                column.resize(count);
+                if constexpr (std::is_trivially_copyable_v<std::decay_t<decltype(column[0])>>) {
+                    complete = complete && reader.read(column.data(), count * sizeof(column[0]));
+                } else {
+                    for (auto& value : column) {
+                        complete = complete && read_component(reader, value);
+                    }
+                }
+            });
+            if (!complete) {
+                return false;
+            }
+        } else if constexpr (std::is_trivially_copyable_v<T> && std::is_same_v<component_storage<T>, std::pmr::vector<T>>) {
+            arr.resize(count);
+            if (!reader.read(arr.data(), count * sizeof(T))) {
+                return false;
+            }
+        } else {
+            for (std::size_t i = 0; i < count; i++) {
+                T& component = arr.emplace_back();
+                if (!read_component(reader, component)) {
+                    return false;
+                }
+            }
+        }
+        if (this->tracking) {
+            this->changes.assign(count, {});
+        }
+        return true;
+    }
+
+    /**
+     * Sorts the pool in place in ascending order by compare. An insertion sort
+     * runs first since pools sorted every frame are usually nearly sorted, if it
+     * needs more than INSERTION_SORT_MOVES moves per component the rest is
+     * sorted by index and the components are then permuted into place.
+     */
+    template <typename Compare>
+    void sort(Compare compare)
+    {
+        const std::size_t count = arr.size();
+        std::size_t moves_left = count * INSERTION_SORT_MOVES;
+        for (std::size_t i = 1; i < count; i++) {
+            for (std::size_t j = i; j > 0 && compare(arr[j], arr[j - 1]); j--) {
+                component_allocator::swap_positions(j, j - 1);
+                if (--moves_left == 0) {
+                    sort_by_index(compare);
+                    return;
+                }
+            }
+        }
+    }
+
+    /**
+     * Moves the entities of this pool that are also in other to the front,
+     * in the same order as they are in other.
+     */
+    void sort_as(const sparse_set<entity_id>& other)
+    {
+        std::size_t position = 0;
+        for (const auto entity : other.entities) {
+            if (this->contains(entity)) {
+                component_allocator::swap_positions(this->index_of(entity), position++);
+            }
+        }
+    }
+
+private:
+    template <typename Compare>
+    void sort_by_index(Compare compare)
+    {
+        // order[i] is the position of the component that belongs at i
+        std::pmr::vector<std::size_t> order(arr.size(), this->resource());
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::sort(order.begin(), order.end(), [this, &compare](std::size_t a, std::size_t b) {
+            return compare(arr[a], arr[b]);
+        });
+        // Follow each cycle of the permutation, every swap puts one component
+        // in its final place
+        for (std::size_t i = 0; i < order.size(); i++) {
+            std::size_t current = i;
+            while (order[current] != i) {
+                const std::size_t next = order[current];
+                component_allocator::swap_positions(current, next);
+                order[current] = current;
+                current = next;
+            }
+            order[current] = current;
+        }
+    }
+};
+
+/**
+ * Handles all direct component interaction. Encapsulating class
+ * for registry.
+ */
+template <typename entity_id>
+class component_manager
+{
+public:
+    explicit component_manager(std::pmr::memory_resource* resource)
+        : allocators(resource)
+    {}
+    /**
+     * Copies or moves component into the pool of passed entity and returns a
+     * reference to it.
+     */
+    template <typename T, typename Arg>
+    decltype(auto) insert(entity_id entity, Arg&& component)
+    {
+        return assure<T>()->insert(entity, std::forward<Arg>(component));
+    }
+   
+    /**
+     * Returns component associated with passed entity as reference.
+     */
+    template <typename T>
+    decltype(auto) get(entity_id entity)
+    {
+        const auto allocator = find<T>();
+        ADK_ASSERT(allocator != nullptr);
+        return allocator->get(entity);
+    }
+    
+    /**
+     * Destructs the specified component type that is associated with the passed entity.
+     */
+    template <typename T>
+    void destroy(entity_id entity)
+    {
+        const auto allocator = find<T>();
+        ADK_ASSERT(allocator != nullptr);
+        return allocator->destroy(entity);
+    }
+
+    /**
+     * Returns the allocator for the specified type, or nullptr if no component
+     * of that type has been inserted yet.
+     */
+    template <typename T>
+    component_allocator<entity_id, T>* find()
+    {
+        const auto component_id = get_component_id<T>();
+        if (component_id >= allocators.size()) {
+            return nullptr;
+        }
+        return static_cast<component_allocator<entity_id, T>*>(allocators[component_id].get());
+    }
+
+    template <typename T>
+    const component_allocator<entity_id, T>* find() const
+    {
+        return const_cast<component_manager*>(this)->template find<T>();
+    }
+
+    /**
+     * Returns the allocator for the passed component id, or nullptr if there is none.
+     */
+    i_component_allocator<entity_id>* find(std::size_t component_id)
+    {
+        return component_id < allocators.size() ? allocators[component_id].get() : nullptr;
+    }
+
+    /**
+     * Returns the allocator for the specified type, creating it if it doesn't exist.
+     */
+    template <typename T>
+    component_allocator<entity_id, T>* assure()
+    {
+        static_assert(!is_tag<T>, "Tag components have no storage");
+        const auto component_id = get_component_id<T>();
+        if (component_id >= allocators.size()) {
+            allocators.resize(component_id + 1);
+        }
+        if (!allocators[component_id]) {
+            std::pmr::polymorphic_allocator<component_allocator<entity_id, T>> allocator(allocators.get_allocator());
+            allocators[component_id].reset(allocator.template new_object<component_allocator<entity_id, T>>(allocator.resource()));
+            allocators[component_id]->name = type_name<T>();
+        }
+        return static_cast<component_allocator<entity_id, T>*>(allocators[component_id].get());
+    }
+    
+    /**
+     * Returns one past the highest component id that may have an allocator.
+     */
+    std::size_t id_count() const
+    {
+        return allocators.size();
+    }
+
+    /**
+     * Calls func with the component id and allocator of every pool.
+     */
+    template <typename Func>
+    void for_each_allocator(Func func) const
+    {
+        for (std::size_t i = 0; i < allocators.size(); i++) {
+            if (allocators[i]) {
+                func(i, *allocators[i]);
+            }
+        }
+    }
+
+    /**
+     * Removes every component from every pool.
+     */
+    void clear()
+    {
+        for (auto& allocator : allocators) {
+            if (allocator) {
+                allocator->clear();
+            }
+        }
+    }
+
+    /**
+     * Forgets the recorded changes of every tracked pool.
+     */
+    void clear_changes()
+    {
+        for (auto& allocator : allocators) {
+            if (allocator) {
+                allocator->clear_changes();
+            }
+        }
+    }
+
+    /**
+     * Destructs all components associated with specified entity
+     */
+    void entity_destroyed(entity_id entity)
+    {
+        for (auto& allocator : allocators) {
+            if (allocator) {
+                allocator->entity_destroyed(entity);
+            }
+        }
+    }
+
+private:
+    struct allocator_deleter
+    {
+        void operator()(i_component_allocator<entity_id>* allocator) const
+        {
+            allocator->dispose();
+        }
+    };
+
+    // Indexed by component id, null where a type has no allocator yet
+    std::pmr::vector<std::unique_ptr<i_component_allocator<entity_id>, allocator_deleter>> allocators;
+};
+
+/**
+ * Fixed-width set of component bits held by every entity. The highest bit marks
+ * the entity as alive so that the same masked compare can skip dead slots,
+ * which leaves bits - 1 bits for component ids.
+ */
+template <std::size_t bits>
+struct signature
+{
+    static_assert(bits > 0 && bits % 64 == 0, "Signature width must be a multiple of 64");
+    static constexpr std::size_t word_count = bits / 64;
+    static constexpr std::size_t alive_bit = bits - 1;
+
+    std::array<std::uint64_t, word_count> words{};
+
+    /**
+     * Returns the bit of a component id, aborting if the id doesn't fit below
+     * the alive bit. Checked in every build, since an id that doesn't fit
+     * either aliases the alive bit or lands past the end of words.
+     */
+    static std::size_t component_bit(std::size_t component_id)
+    {
+        if (component_id >= alive_bit) [[unlikely]] {
+            std::fprintf(stderr, "adk::ecs: component id %zu doesn't fit in a %zu bit signature, "
+                "raise the registry's max_components\n", component_id, bits);
+            std::abort();
+        }
+        return component_id;
+    }
+
+    void set(std::size_t bit)
+    {
+        words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+    }
+
+    void reset(std::size_t bit)
+    {
+        words[bit / 64] &= ~(std::uint64_t(1) << (bit % 64));
+    }
+
+    bool test(std::size_t bit) const
+    {
+        return (words[bit / 64] & (std::uint64_t(1) << (bit % 64))) != 0;
+    }
+
+    signature& operator|=(const signature& other)
+    {
+        for (std::size_t i = 0; i < word_count; i++) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+
+    /**
+     * Calls func with the id of every component bit that is set.
+     */
+    template <typename Func>
+    void for_each_component(Func func) const
+    {
+        for (std::size_t i = 0; i < word_count; i++) {
+            std::uint64_t word = words[i];
+            while (word != 0) {
+                const std::size_t bit = i * 64 + std::countr_zero(word);
+                word &= word - 1;
+                if (bit != alive_bit) {
+                    func(bit);
+                }
+            }
+        }
+    }
+
+    /**
+     * Returns whether or not every bit set in mask is also set here.
+     */
+    bool contains(const signature& mask) const
+    {
+        return matches(mask, mask);
+    }
+
+    /**
+     * Returns whether or not the bits set in care are set here exactly as they
+     * are in wanted, which tests for included and excluded bits in one compare.
+     */
+    bool matches(const signature& care, const signature& wanted) const
+    {
+        for (std::size_t i = 0; i < word_count; i++) {
+            if ((words[i] & care.words[i]) != wanted.words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * Tests up to SIGNATURE_BLOCK consecutive signatures against a pair of masks and
+ * returns a bitmask with bit i set if signatures[i].matches(care, wanted). Narrow
+ * signatures are tested several per instruction, wide ones a vector register at
+ * a time.
+ */
+template <std::size_t bits>
+std::uint64_t match_signatures(const signature<bits>* signatures, std::size_t count, const signature<bits>& care,
+    const signature<bits>& wanted)
+{
+    ADK_ASSERT(count <= SIGNATURE_BLOCK);
+    std::uint64_t matches = 0;
+    std::size_t i = 0;
+#if defined(ADK_ECS_AVX2)
+    if constexpr (bits == 64) {
+        const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(care.words[0]));
+        const __m256i expected = _mm256_set1_epi64x(static_cast<long long>(wanted.words[0]));
+        for (; i + 4 <= count; i += 4) {
+            const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&signatures[i]));
+            const __m256i equal = _mm256_cmpeq_epi64(_mm256_and_si256(words, mask), expected);
+            const auto lanes = static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(equal)));
+            matches |= lanes << i;
+        }
+    } else if constexpr (bits % 256 == 0) {
+        for (; i < count; i++) {
+            bool match = true;
+            for (std::size_t word = 0; word < bits / 64 && match; word += 4) {
+                const __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&care.words[word]));
+                const __m256i expected = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&wanted.words[word]));
+                const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&signatures[i].words[word]));
+                const __m256i equal = _mm256_cmpeq_epi64(_mm256_and_si256(words, mask), expected);
+                match = _mm256_movemask_epi8(equal) == -1;
+            }
+            matches |= std::uint64_t(match) << i;
+        }
+    }
+#endif
+#if defined(ADK_ECS_SSE2)
+    if constexpr (bits == 64) {
+        const __m128i mask = _mm_set1_epi64x(static_cast<long long>(care.words[0]));
+        const __m128i expected = _mm_set1_epi64x(static_cast<long long>(wanted.words[0]));
+        for (; i + 2 <= count; i += 2) {
+            const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&signatures[i]));
+            const __m128i equal = _mm_cmpeq_epi32(_mm_and_si128(words, mask), expected);
+            const int bytes = _mm_movemask_epi8(equal);
+            matches |= std::uint64_t((bytes & 0x00FF) == 0x00FF) << i;
+            matches |= std::uint64_t((bytes & 0xFF00) == 0xFF00) << (i + 1);
+        }
+    } else if constexpr (bits % 128 == 0) {
+        for (; i < count; i++) {
+            bool match = true;
+            for (std::size_t word = 0; word < bits / 64 && match; word += 2) {
+                const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&care.words[word]));
+                const __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&wanted.words[word]));
+                const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&signatures[i].words[word]));
+                const __m128i equal = _mm_cmpeq_epi32(_mm_and_si128(words, mask), expected);
+                match = _mm_movemask_epi8(equal) == 0xFFFF;
+            }
+            matches |= std::uint64_t(match) << i;
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        matches |= std::uint64_t(signatures[i].matches(care, wanted)) << i;
+    }
+    return matches;
+}
+
+/**
+ * Tuple type concatenation
+ */
+template <typename... Tuples>
+struct tuple_cat_s;
+
+/**
+ * Recursive case, combine both tuple types and call again with new one
+ * and other types
+ */
+template <typename... Ts, typename... Us, typename... Tuples>
+struct tuple_cat_s<std::tuple<Ts...>, std::tuple<Us...>, Tuples...>
+    : tuple_cat_s<std::tuple<Ts..., Us...>, Tuples...> {};
+
+/**
+ * Base case, simple tuple without any nested
+ */
+template <typename... Ts>
+struct tuple_cat_s<std::tuple<Ts...>> 
+{
+    using type = std::tuple<Ts...>;
+};
+
+/**
+ * Alias for tuple_cat_s::type for ease of use
+ */
+template <typename... Tuples>
+using tuple_cat_t = typename tuple_cat_s<Tuples...>::type;
+
+/**
+ * Filter wrappers for query terms, exposed as adk::ecs::added and adk::ecs::changed.
+ */
+template <typename T>
+struct added_filter {};
+
+template <typename T>
+struct changed_filter {};
+
+/**
+ * Single component forms of adk::ecs::exclude and adk::ecs::optional.
+ */
+template <typename T>
+struct exclude_filter {};
+
+template <typename T>
+struct optional_filter {};
+
+/**
+ * Term lists exposed as adk::ecs::include, adk::ecs::exclude and adk::ecs::optional.
+ */
+template <typename... Types>
+struct include_terms {};
+
+template <typename... Types>
+struct exclude_terms {};
+
+template <typename... Types>
+struct optional_terms {};
+
+/**
+ * Member columns of a split component, exposed as adk::ecs::members.
+ */
+template <typename T, std::size_t... Indexes>
+struct member_terms {};
+
+enum class term_filter : std::uint8_t
+{
+    none,
+    added,
+    changed,
+};
+
+enum class term_access : std::uint8_t
+{
+    required,
+    excluded,
+    optional,
+};
+
+/**
+ * Splits a view parameter into the component type it refers to, the filter
+ * applied to it and what it adds to the tuple handed out for each match.
+ * Split components have no object to reference, so they add nothing unless
+ * some of their columns are asked for.
+ */
+template <typename T>
+struct query_term
+{
+    using component = T;
+    using value = std::conditional_t<split_component<T>, std::tuple<>, std::tuple<T&>>;
+    using column_indexes = std::index_sequence<>;
+    static constexpr term_filter filter = term_filter::none;
+    static constexpr term_access access = term_access::required;
+    static constexpr bool read_only = false;
+};
+
+/**
+ * Const terms hand out const references and don't count as writes of the
+ * component's pool, see extract_buffer.
+ */
+template <typename T>
+struct query_term<const T> : query_term<T>
+{
+    using value = std::conditional_t<split_component<T>, std::tuple<>, std::tuple<const T&>>;
+    static constexpr bool read_only = true;
+};
+
+template <typename T, std::size_t... Indexes>
+struct query_term<member_terms<T, Indexes...>> : query_term<T>
+{
+    static_assert(split_component<T>, "Only split components are stored in columns");
+
+    using value = std::tuple<column_t<T, Indexes>&...>;
+    using column_indexes = std::index_sequence<Indexes...>;
+};
+
+template <typename T>
+struct query_term<added_filter<T>> : query_term<T>
+{
+    static constexpr term_filter filter = term_filter::added;
+};
+
+template <typename T>
+struct query_term<changed_filter<T>> : query_term<T>
+{
+    static constexpr term_filter filter = term_filter::changed;
+};
+
+template <typename T>
+struct query_term<exclude_filter<T>> : query_term<T>
+{
+    using value = std::tuple<>;
+    static constexpr term_access access = term_access::excluded;
+};
+
+template <typename T>
+struct query_term<optional_filter<T>> : query_term<T>
+{
+    static_assert(!split_component<std::remove_const_t<T>>, "Split components have no object to point to");
+
+    using value = std::tuple<T*>;
+    static constexpr term_access access = term_access::optional;
+};
+
+template <typename T>
+using component_t = typename query_term<T>::component;
+
+template <typename... Terms>
+constexpr bool has_filters = ((query_term<Terms>::filter != term_filter::none) || ...);
+
+template <typename T>
+constexpr bool is_required = query_term<T>::access == term_access::required;
+
+/**
+ * Expands term lists into one term per component.
+ */
+template <typename T>
+struct flatten_term
+{
+    using type = std::tuple<T>;
+};
+
+template <typename... Types>
+struct flatten_term<include_terms<Types...>>
+{
+    using type = tuple_cat_t<std::tuple<>, typename flatten_term<Types>::type...>;
+};
+
+template <typename... Types>
+struct flatten_term<exclude_terms<Types...>>
+{
+    using type = std::tuple<exclude_filter<Types>...>;
+};
+
+template <typename... Types>
+struct flatten_term<optional_terms<Types...>>
+{
+    using type = std::tuple<optional_filter<Types>...>;
+};
+
+template <typename... Terms>
+using flat_terms = tuple_cat_t<std::tuple<>, typename flatten_term<Terms>::type...>;
+
+/**
+ * Tuple type handed out by a view for each match, the entity followed by a
+ * reference to each required component and a pointer to each optional one.
+ */
+template <typename entity_id, typename... Types>
+using view_tuple = tuple_cat_t<std::tuple<entity_id>, typename query_term<Types>::value...>;
+
+/**
+ * Number of candidates handed to a thread at once when iterating in parallel,
+ * sized so that a chunk's ids and components roughly fit in L1.
+ */
+template <typename entity_id, typename... Types>
+constexpr std::size_t parallel_chunk_size()
+{
+    constexpr std::size_t bytes = (sizeof(entity_id) + ... +
+        (is_tag<component_t<Types>> || query_term<Types>::access == term_access::excluded ? 0 : sizeof(component_t<Types>)));
+    return std::max(MIN_PARALLEL_CHUNK, PARALLEL_CHUNK_BYTES / bytes);
+}
+
+/**
+ * Unit of work for the thread pool, runs func over the index range [begin, end).
+ * Kept as a plain function pointer so a task never needs a heap-allocated
+ * closure, though the worker queues still allocate when they grow.
+ */
+struct task
+{
+    void (*func)(void* context, std::size_t begin, std::size_t end);
+    void* context;
+    std::size_t begin;
+    std::size_t end;
+};
+
+/**
+ * Whether or not T is one of Types.
+ */
+template <typename T, typename... Types>
+constexpr bool contains_type = (std::is_same_v<T, Types> || ...);
+
+/**
+ * Whether or not two tuples of types share any type.
+ */
+template <typename A, typename B>
+struct types_intersect;
+
+template <typename... As, typename... Bs>
+struct types_intersect<std::tuple<As...>, std::tuple<Bs...>>
+{
+    static constexpr bool value = (contains_type<As, Bs...> || ...);
+};
+
+} // namespace adk::ecs::internal
+
+// Public interface
+namespace adk::ecs
+{
+
+/**
+ * View parameter that only matches entities whose T component was added since
+ * changes were last cleared. Requires tracking to be enabled for T.
+ */
+template <typename T>
+using added = internal::added_filter<T>;
+
+/**
+ * View parameter that only matches entities whose T component was modified
+ * through registry::patch since changes were last cleared. Requires tracking
+ * to be enabled for T.
+ */
+template <typename T>
+using changed = internal::changed_filter<T>;
+
+/**
+ * View parameter listing components an entity must have, the same as passing
+ * them directly.
+ */
+template <typename... Types>
+using include = internal::include_terms<Types...>;
+
+/**
+ * View parameter listing components an entity must not have. They are tested
+ * in the same signature compare as the required ones and aren't passed to the
+ * view's function.
+ */
+template <typename... Types>
+using exclude = internal::exclude_terms<Types...>;
+
+/**
+ * View parameter listing components that are passed as pointers, null when
+ * the entity doesn't have them. They don't affect which entities match.
+ */
+template <typename... Types>
+using optional = internal::optional_terms<Types...>;
+
+/**
+ * View parameter that matches entities with the split component T and passes
+ * references to its members at the passed indexes, in ADK_REFLECT_CLASS order.
+ * Can be wrapped in added or changed like T itself.
+ *
+ *     reg.for_each<members<particle, 0, 3>>([](auto e, float& x, float& vx) { x += vx; });
+ */
+template <typename T, std::size_t... Indexes>
+using members = internal::member_terms<T, Indexes...>;
+
+/**
+ * Work-stealing thread pool used for parallel iteration. Every worker owns a
+ * queue that it pops from the back of, idle workers steal from the front of
+ * the others. A thread waiting on work also runs tasks until it is done, so
+ * a pool with no workers just runs everything on the calling thread.
+ */
+class thread_pool
+{
+public:
+    explicit thread_pool(std::size_t worker_count = default_worker_count())
+        : queues(worker_count + 1)
+    {
+        workers.reserve(worker_count);
+        for (std::size_t i = 0; i < worker_count; i++) {
+            workers.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep_condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * Returns number of threads that can run tasks, including the waiting thread.
+     */
+    std::size_t concurrency() const
+    {
+        return workers.size() + 1;
+    }
+
+    /**
+     * Returns index of the calling thread in [0, concurrency()), workers get
+     * their own index and any other thread gets the last one. Useful for
+     * picking a per-thread command buffer inside parallel iteration.
+     */
+    std::size_t thread_index() const
+    {
+        return current_pool == this ? current_index : workers.size();
+    }
+
+    /**
+     * Queues a task. Workers push to their own queue, other threads spread
+     * tasks over all queues.
+     */
+    void push(internal::task task)
+    {
+        std::size_t index;
+        if (current_pool == this) {
+            index = current_index;
+        } else {
+            index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        }
+        {
+            std::lock_guard lock(queues[index].mutex);
+            queues[index].tasks.push_back(task);
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard lock(sleep_mutex);
+        }
+        sleep_condition.notify_one();
+    }
+
+    /**
+     * Runs queued tasks on the calling thread until remaining reaches zero.
+     */
+    void wait(const std::atomic<std::size_t>& remaining)
+    {
+        const std::size_t self = current_pool == this ? current_index : queues.size() - 1;
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            if (!run_one(self)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * Splits [0, count) into chunks of grain and calls func(begin, end) on each,
+     * returning once all of them have run. If func throws, chunks that haven't
+     * started yet are skipped and the first exception is rethrown once every
+     * chunk is done, so nothing is left referring to the call.
+     */
+    template <typename Func>
+    void parallel_for(std::size_t count, std::size_t grain, Func& func)
+    {
+        grain = std::max<std::size_t>(grain, 1);
+        const std::size_t chunks = (count + grain - 1) / grain;
+        if (chunks <= 1 || workers.empty()) {
+            if (count > 0) {
+                func(0, count);
+            }
+            return;
+        }
+
+        struct job
+        {
+            Func* func;
+            std::atomic<std::size_t> remaining;
+#ifdef ADK_ECS_EXCEPTIONS
+            std::atomic<bool> failed = false;
+            std::exception_ptr error = nullptr;
+#endif
+        } state = { &func, chunks };
+
+        const auto run_chunk = [](void* context, std::size_t begin, std::size_t end) {
+            auto* state = static_cast<job*>(context);
+#ifdef ADK_ECS_EXCEPTIONS
+            // Only the first thread to fail stores its exception, the release
+            // below publishes it to the waiting thread
+            if (!state->failed.load(std::memory_order_relaxed)) {
+                try {
+                    (*state->func)(begin, end);
+                } catch (...) {
+                    if (!state->failed.exchange(true, std::memory_order_relaxed)) {
+                        state->error = std::current_exception();
+                    }
+                }
+            }
+#else
+            (*state->func)(begin, end);
+#endif
+            state->remaining.fetch_sub(1, std::memory_order_release);
+        };
+        for (std::size_t begin = 0; begin < count; begin += grain) {
+            push({ run_chunk, &state, begin, std::min(begin + grain, count) });
+        }
+        wait(state.remaining);
+#ifdef ADK_ECS_EXCEPTIONS
+        if (state.error) {
+            std::rethrow_exception(state.error);
+        }
+#endif
+    }
+
+private:
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<internal::task> tasks;
+    };
+
+    inline static thread_local const thread_pool* current_pool = nullptr;
+    inline static thread_local std::size_t current_index = 0;
+
+    std::vector<std::thread> workers;
+    std::vector<task_queue> queues;
+    std::atomic<std::size_t> queued = 0;
+    std::atomic<std::size_t> next_queue = 0;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+    bool stopping = false;
+
+    static std::size_t default_worker_count()
+    {
+        const std::size_t hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 0;
+    }
+
+    /**
+     * Pops a task from the back of our own queue or steals one from the front
+     * of another, then runs it. Returns false if every queue was empty.
+     */
+    bool run_one(std::size_t self)
+    {
+        internal::task task;
+        bool found = false;
+        for (std::size_t i = 0; i < queues.size() && !found; i++) {
+            auto& queue = queues[(self + i) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            found = true;
+        }
+        if (!found) {
+            return false;
+        }
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        task.func(task.context, task.begin, task.end);
+        return true;
+    }
+
+    void worker_loop(std::size_t index)
+    {
+        current_pool = this;
+        current_index = index;
+        while (true) {
+            if (run_one(index)) {
+                continue;
+            }
+            std::unique_lock lock(sleep_mutex);
+            sleep_condition.wait(lock, [this]() {
+                return stopping || queued.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping && queued.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+};
+
+/**
+ * Shared pool used by parallel iteration when one isn't passed explicitly.
+ */
+inline thread_pool& default_thread_pool()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+template <typename entity_id, std::size_t max_components>
+class command_buffer;
+
+template <typename entity_id, std::size_t max_components>
+class prefab;
+
+template <typename Registry, typename... Types>
+class extract_buffer;
+
+/**
+ * Allocation counters of a counting_resource.
+ */
+struct memory_stats
+{
+    std::size_t bytes_in_use = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t allocations = 0;
+};
+
+/**
+ * Memory resource that forwards to an upstream resource and counts what passes
+ * through it. Every registry allocates through one of these, see
+ * registry::memory_usage. Not thread-safe.
+ */
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream(upstream)
+    {}
+
+    std::pmr::memory_resource* upstream_resource() const
+    {
+        return upstream;
+    }
+
+    const memory_stats& stats() const
+    {
+        return counters;
+    }
+
+private:
+    std::pmr::memory_resource* upstream;
+    memory_stats counters;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        const auto memory = upstream->allocate(bytes, alignment);
+        counters.bytes_in_use += bytes;
+        counters.peak_bytes = std::max(counters.peak_bytes, counters.bytes_in_use);
+        counters.allocations++;
+        return memory;
+    }
+
+    void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+    {
+        upstream->deallocate(memory, bytes, alignment);
+        counters.bytes_in_use -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+/**
+ * Bump allocator that carves allocations out of large blocks taken from an
+ * upstream resource. Deallocating does nothing, all of the memory is given back
+ * at once by release() or the destructor. Pass it to a registry to give the
+ * registry its own arena that can be dropped in one go, the registry must be
+ * destroyed before the arena. Not thread-safe.
+ */
+class bump_arena : public std::pmr::memory_resource
+{
+public:
+    explicit bump_arena(std::size_t block_size = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream(upstream),
+          block_size(block_size)
+    {}
+
+    bump_arena(const bump_arena&) = delete;
+    bump_arena& operator=(const bump_arena&) = delete;
+
+    ~bump_arena()
+    {
+        release();
+    }
+
+    /**
+     * Gives every block back to the upstream resource, invalidating everything
+     * allocated from the arena.
+     */
+    void release()
+    {
+        while (blocks != nullptr) {
+            const auto block = blocks;
+            blocks = block->next;
+            upstream->deallocate(block, block->size, block->alignment);
+        }
+        cursor = nullptr;
+        remaining = 0;
+        used = 0;
+        reserved = 0;
+    }
+
+    /**
+     * Returns number of bytes handed out since the last release.
+     */
+    std::size_t bytes_used() const
+    {
+        return used;
+    }
+
+    /**
+     * Returns number of bytes taken from the upstream resource.
+     */
+    std::size_t bytes_reserved() const
+    {
+        return reserved;
+    }
+
+private:
+    struct block_header
+    {
+        block_header* next;
+        std::size_t size;
+        std::size_t alignment;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::size_t block_size;
+    block_header* blocks = nullptr;
+    std::byte* cursor = nullptr;
+    std::size_t remaining = 0;
+    std::size_t used = 0;
+    std::size_t reserved = 0;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* memory = cursor;
+        if (cursor == nullptr || std::align(alignment, bytes, memory, remaining) == nullptr) {
+            add_block(bytes, alignment);
+            memory = cursor;
+            std::align(alignment, bytes, memory, remaining);
+        }
+        cursor = static_cast<std::byte*>(memory) + bytes;
+        remaining -= bytes;
+        used += bytes;
+        return memory;
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override
+    {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    /**
+     * Takes a new block from upstream that's big enough for the allocation.
+     */
+    void add_block(std::size_t bytes, std::size_t alignment)
+    {
+        const std::size_t block_alignment = std::max(alignof(block_header), alignment);
+        const std::size_t header = (sizeof(block_header) + alignment - 1) / alignment * alignment;
+        const std::size_t size = std::max(block_size, header + bytes);
+        const auto block = static_cast<block_header*>(upstream->allocate(size, block_alignment));
+        *block = { blocks, size, block_alignment };
+        blocks = block;
+        cursor = reinterpret_cast<std::byte*>(block) + sizeof(block_header);
+        remaining = size - sizeof(block_header);
+        reserved += size;
+    }
+};
+
+/**
+ * Pool allocator with power of two size classes from 16 bytes up to
+ * max_block_size, each with its own free list that's refilled a chunk at a time
+ * from an upstream resource. Blocks are aligned to their size. Larger
+ * allocations go straight to upstream. Freed blocks are kept for reuse until
+ * release() or the destructor. Not thread-safe.
+ */
+class size_class_pool : public std::pmr::memory_resource
+{
+public:
+    static constexpr std::size_t min_block_size = 16;
+    static constexpr std::size_t max_block_size = 4096;
+
+    explicit size_class_pool(std::size_t chunk_size = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream(upstream),
+          chunk_size(std::max(chunk_size, 2 * max_block_size))
+    {}
+
+    size_class_pool(const size_class_pool&) = delete;
+    size_class_pool& operator=(const size_class_pool&) = delete;
+
+    ~size_class_pool()
+    {
+        release();
+    }
+
+    /**
+     * Gives every chunk back to the upstream resource, invalidating all pooled
+     * blocks. Allocations that bypassed the pool are not affected.
+     */
+    void release()
+    {
+        while (chunks != nullptr) {
+            const auto chunk = chunks;
+            chunks = chunk->next;
+            upstream->deallocate(chunk, chunk->size, max_block_size);
+        }
+        free_lists = {};
+        used = 0;
+        reserved = 0;
+    }
+
+    /**
+     * Returns number of bytes currently handed out, rounded up to size classes.
+     */
+    std::size_t bytes_used() const
+    {
+        return used;
+    }
+
+    /**
+     * Returns number of bytes held in chunks taken from the upstream resource.
+     */
+    std::size_t bytes_reserved() const
+    {
+        return reserved;
+    }
+
+private:
+    static constexpr std::size_t class_count = std::countr_zero(max_block_size) - std::countr_zero(min_block_size) + 1;
+
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    // Chunks start with this header, blocks are carved from the rest
+    struct chunk_header
+    {
+        chunk_header* next;
+        std::size_t size;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::size_t chunk_size;
+    chunk_header* chunks = nullptr;
+    std::array<free_block*, class_count> free_lists = {};
+    std::size_t used = 0;
+    std::size_t reserved = 0;
+
+    static std::size_t class_size(std::size_t bytes, std::size_t alignment)
+    {
+        return std::bit_ceil(std::max({ bytes, alignment, min_block_size }));
+    }
+
+    static std::size_t class_index(std::size_t size)
+    {
+        return std::countr_zero(size) - std::countr_zero(min_block_size);
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        const std::size_t size = class_size(bytes, alignment);
+        if (size > max_block_size) {
+            return upstream->allocate(bytes, alignment);
+        }
+        auto& list = free_lists[class_index(size)];
+        if (list == nullptr) {
+            refill(list, size);
+        }
+        const auto block = list;
+        list = block->next;
+        used += size;
+        return block;
+    }
+
+    void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+    {
+        const std::size_t size = class_size(bytes, alignment);
+        if (size > max_block_size) {
+            upstream->deallocate(memory, bytes, alignment);
+            return;
+        }
+        auto& list = free_lists[class_index(size)];
+        list = new (memory) free_block{ list };
+        used -= size;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    /**
+     * Splits a new chunk into blocks of size. The header takes up the first
+     * max_block_size bytes so that every block stays aligned to its size.
+     */
+    void refill(free_block*& list, std::size_t size)
+    {
+        const auto chunk = static_cast<chunk_header*>(upstream->allocate(chunk_size, max_block_size));
+        *chunk = { chunks, chunk_size };
+        chunks = chunk;
+        reserved += chunk_size;
+        const auto first = reinterpret_cast<std::byte*>(chunk) + max_block_size;
+        const std::size_t count = (chunk_size - max_block_size) / size;
+        for (std::size_t i = count; i > 0; i--) {
+            list = new (first + (i - 1) * size) free_block{ list };
+        }
+    }
+};
+
+/**
+ * Links of an entity in the registry's hierarchy, see registry::set_parent.
+ * Children of a parent form a doubly linked list through their siblings.
+ * Managed by the registry, it must not be assigned or modified directly.
+ */
+template <typename entity_id>
+struct relationship
+{
+    static constexpr entity_id null = internal::create_invalid_entity<entity_id>();
+
+    entity_id parent = null;
+    entity_id first_child = null;
+    entity_id prev_sibling = null;
+    entity_id next_sibling = null;
+    // Distance from the root
+    std::uint32_t depth = 0;
+};
+
+/**
+ * Histogram of durations with power of two buckets, bucket i counts samples
+ * that took [2^i, 2^(i + 1)) nanoseconds and the last one everything longer.
+ */
+struct timing_histogram
+{
+    static constexpr std::size_t bucket_count = 40;
+
+    std::array<std::uint64_t, bucket_count> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t total_ns = 0;
+    std::uint64_t max_ns = 0;
+
+    void record(std::uint64_t ns)
+    {
+        const std::size_t bucket = ns == 0 ? 0 : std::bit_width(ns) - 1;
+        buckets[std::min(bucket, bucket_count - 1)]++;
+        count++;
+        total_ns += ns;
+        max_ns = std::max(max_ns, ns);
+    }
+
+    double mean_ns() const
+    {
+        return count == 0 ? 0.0 : static_cast<double>(total_ns) / static_cast<double>(count);
+    }
+};
+
+/**
+ * Size of a component pool, see registry::stats.
+ */
+struct pool_stats
+{
+    std::size_t component_id = 0;
+    std::string_view name;
+    std::size_t size = 0;
+    std::size_t capacity = 0;
+    std::size_t bytes = 0;
+};
+
+/**
+ * Counters of one for_each or par_for_each parameter list, only collected
+ * with ADK_ECS_INSTRUMENTATION. Candidates are the entities a view looked at,
+ * rejections the ones whose signature didn't match.
+ */
+struct query_stats
+{
+    std::string_view name;
+    std::uint64_t candidates = 0;
+    std::uint64_t rejections = 0;
+    timing_histogram timing;
+};
+
+/**
+ * Timings of a scheduler system, only collected with ADK_ECS_INSTRUMENTATION.
+ */
+struct system_stats
+{
+    std::string_view name;
+    timing_histogram timing;
+};
+
+/**
+ * Snapshot of a registry's state returned by registry::stats.
+ */
+struct registry_stats
+{
+    std::size_t entity_slots = 0;
+    std::size_t live_entities = 0;
+    std::size_t free_slots = 0;
+    memory_stats memory;
+    std::vector<pool_stats> pools;
+    // Totals over every query, only counted with ADK_ECS_INSTRUMENTATION
+    std::uint64_t view_candidates = 0;
+    std::uint64_t view_rejections = 0;
+    std::vector<query_stats> queries;
+};
+
+/**
+ * Monolothic ECS registry, handles creating and destroying entities
+ * as well as manipulating them with components. The first template parameter
+ * specifies the underlying type for an entity id. Half of the bits will
+ * be used as an index and the other half will be used as versioning.
+ *
+ * Ex. if you have adk::registry<std::uint32_t> then the index is 16 bits
+ * and the version is 16 bits. This means you can have a maximum of 2^16 entities.
+ *
+ * The second template parameter is the width of each entity's signature in bits,
+ * a multiple of 64. One bit is reserved, so a registry<std::uint32_t, 256> supports
+ * 255 component types. Component ids are global to the process rather than to a
+ * registry, every component type used with any registry, prefab or scheduler
+ * takes one, so the width has to cover all of them. Using a component whose id
+ * doesn't fit aborts with a message.
+ */
+template <typename entity_id = internal::DEFAULT_ENTITY_ID_TYPE, std::size_t max_components = internal::MAX_COMPONENTS>
+class registry
+{
+private:
+    template <typename Registry, typename... Types>
+    friend class extract_buffer;
+
+    using signature = internal::signature<max_components>;
+
+    // Everything below allocates through this. It's allocated from the upstream
+    // resource itself so that its address survives moving the registry.
+    internal::resource_ptr<counting_resource> memory;
+
+    // Always present so the layout doesn't depend on ADK_ECS_INSTRUMENTATION,
+    // only filled in when it's defined
+    struct instrumentation_state
+    {
+        std::mutex mutex;
+        // Indexed by query id
+        std::pmr::vector<query_stats> queries;
+
+        explicit instrumentation_state(std::pmr::memory_resource* resource)
+            : queries(resource)
+        {}
+    };
+
+    internal::resource_ptr<instrumentation_state> instrumentation
+        = internal::make_resource_ptr<instrumentation_state>(memory.get(), memory.get());
+
+    internal::component_manager<entity_id> component_manager;
+    // Live slots hold their entity id. Free slots form a list, each holding the
+    // index of the next free slot and the version its next entity will get.
+    std::pmr::vector<entity_id> entities;
+    std::pmr::vector<signature> signatures;
+    entity_id free_list = null_index;
+    std::size_t free_count = 0;
+
+    static constexpr entity_id null_index = internal::get_entity_index(internal::create_invalid_entity<entity_id>());
+    // Index held by slots of reserved entities until they are flushed, along
+    // with the version the entity was reserved with. It's never given to an
+    // entity, so no free slot links to it and it can't be mistaken for one.
+    static constexpr entity_id reserved_index = null_index - 1;
+
+    internal::resource_ptr<internal::reservation_state<entity_id>> reservations;
+    // Ring position and entity index up to which reservations have been flushed
+    std::uint64_t flushed_head = 0;
+    std::size_t flushed_index = 0;
+    // Slots holding reserved_index
+    std::size_t reserved_count = 0;
+    // Next step of the current compact pass, see compact
+    std::size_t compact_step = 0;
+    std::pmr::vector<internal::resource_ptr<internal::group_handler<entity_id>>> groups;
+
+    using relationship_type = relationship<entity_id>;
+    // The relationship pool is kept sorted by depth, so walking it in order
+    // visits parents before their children. Element i is the position one past
+    // the last node of depth i.
+    std::pmr::vector<std::size_t> hierarchy_ends;
+    // Reused by set_subtree_depth to collect the nodes it moves
+    std::pmr::vector<entity_id> hierarchy_scratch;
+
+    using listener = std::function<void(registry&, entity_id)>;
+    // Callbacks indexed by component id
+    std::pmr::vector<std::pmr::vector<listener>> construct_listeners;
+    std::pmr::vector<std::pmr::vector<listener>> destroy_listeners;
+
+    internal::resource_table resources;
+
+    /**
+     * Returns the signature bit of a component type.
+     */
+    template <typename T>
+    static std::size_t component_bit()
+    {
+        return signature::component_bit(internal::get_component_id<T>());
+    }
+    
+    /**
+     * Iterator for a registry that takes in types as a template parameter and will
+     * return all components for each entity that possesses all parameter types
+     * as components. Should only be created via factory function.
+     *
+     * Iteration is driven by the packed entity array of the smallest pool among
+     * the parameter types, the rest are only checked for those candidates.
+     * Tags have no pool and are only checked through the signature. When every
+     * parameter type is a tag, or there are none, the signature array is scanned
+     * a block at a time instead.
+     *
+     * If an owning group covers some of the parameter types, its packed range is
+     * used instead when it's smallest. Owned pools are then walked in lockstep, and
+     * when the group owns exactly the parameter types no checks are needed at all.
+     *
+     * Excluded and optional terms never drive iteration. Excluded components are
+     * folded into the signature compare, optional ones are looked up per match.
+     * Types holds one term per component, new_view expands include, exclude
+     * and optional lists into it.
+     */
+    template <typename... Types>
+    class view
+    {
+    public:
+        view(registry& reg)
+            : view(reg, 0, std::numeric_limits<std::size_t>::max())
+        {}
+
+        /**
+         * Restricts the view to candidates [first, last) of the pool driving it,
+         * used to split a view into chunks.
+         */
+        view(registry& reg, std::size_t first, std::size_t last)
+            : reg(reg),
+              pools(reg.component_manager.template find<internal::component_t<Types>>()...)
+        {
+            (mark_written<Types>(), ...);
+            choose_candidates();
+            first_index = std::min(first, end_index);
+            end_index = std::min(last, end_index);
+            current_index = first_index - 1;
+            find_next_valid();
+        }
+
+        using tuple = internal::view_tuple<entity_id, Types...>;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = tuple;
+
+        value_type operator*() const 
+        {
+            const auto entity = current_entity();
+            return std::tuple_cat(std::tuple<entity_id>(entity), get_term<Types>(entity)...);
+        };
+
+        value_type operator->() const 
+        { 
+            const auto entity = current_entity();
+            return std::tuple_cat(std::tuple<entity_id>(entity), get_term<Types>(entity)...);
+        }
+
+        view<Types...>& operator++()
+        {
+            find_next_valid();
+            return *this;
+        }
+
+        view<Types...>& operator+=(int i)
+        {
+            for (int j = 0; j < i; j++) {
+                find_next_valid();
+            }
+            return *this;
+        }
+
+        friend bool operator==(const view& a, const view& b) 
+        { 
+            return a.current_index == b.current_index; 
+        }
+
+        friend bool operator!=(const view& a, const view& b) 
+        { 
+            return a.current_index != b.current_index; 
+        }
 
         view<Types...> begin() 
         { 
-            return view<Types...>(reg);
+            auto v = *this;
+            v.current_index = first_index - 1;
+            // Start over from scratch, the constructor's probe is neither reused
+            // nor counted twice
+            v.block_index = -1;
+            ADK_ECS_INSTRUMENT(v.checked = 0; v.rejected = 0;)
+            v.find_next_valid();
+            return v;
+        }
+
+        view<Types...> end()
+        {
+            auto v = *this;
+            v.current_index = end_index;
+            return v;
+        }
+
+        /**
+         * Calls func with the entity and components of every match.
+         */
+        template <typename Func>
+        void each(Func& func)
+        {
+            auto it = begin();
+            const auto last = end();
+            for (; it != last; ++it) {
+                std::apply(func, *it);
+            }
+            ADK_ECS_INSTRUMENT(checked = it.checked; rejected = it.rejected;)
+        }
+
+        /**
+         * Returns number of candidates the view walks over, an upper bound
+         * on the number of matches.
+         */
+        std::size_t size_hint() const
+        {
+            return end_index - first_index;
+        }
+
+    private:
+        registry& reg;
+        std::tuple<internal::component_allocator<entity_id, internal::component_t<Types>>*...> pools;
+        const std::pmr::vector<entity_id>* candidates = nullptr;
+        const internal::group_handler<entity_id>* group = nullptr;
+        bool exact_group = false;
+        std::size_t current_index = -1;
+        std::size_t first_index = 0;
+        std::size_t end_index = 0;
+        internal::term_filter driver_filter = internal::term_filter::none;
+        const internal::i_component_allocator<entity_id>* driver_pool = nullptr;
+        std::size_t block_index = -1;
+        std::uint64_t block_matches = 0;
+        // Only counted with ADK_ECS_INSTRUMENTATION
+        std::uint64_t checked = 0;
+        std::uint64_t rejected = 0;
+
+        friend registry;
+
+        static constexpr std::size_t required_count = (std::size_t(internal::is_required<Types>) + ... + 0);
+        static constexpr bool has_exclusions = ((internal::query_term<Types>::access == internal::term_access::excluded) || ...);
+        // Whether or not no required term has a pool
+        static constexpr bool scan_signatures = ((internal::is_tag<internal::component_t<Types>> || !internal::is_required<Types>) && ...);
+
+        /**
+         * Signature bits an entity is tested on and the values they must have,
+         * every required and excluded bit plus the alive bit.
+         */
+        struct query_masks
+        {
+            signature care = alive_mask();
+            signature wanted = alive_mask();
+        };
+
+        /**
+         * Masks of this query, built once per type list since component ids don't
+         * change after they have been assigned.
+         */
+        static const query_masks& masks()
+        {
+            static const query_masks result = []() {
+                query_masks masks;
+                (add_term_to_masks<Types>(masks), ...);
+                return masks;
+            }();
+            return result;
+        }
+
+        /**
+         * Components of required and optional terms are handed out by reference,
+         * so their pools count as written unless the term is const. Split terms
+         * only do if they hand out columns.
+         */
+        template <typename Term>
+        void mark_written()
+        {
+            using T = internal::component_t<Term>;
+            constexpr bool hands_out = internal::split_component<T>
+                ? internal::query_term<Term>::column_indexes::size() > 0
+                : internal::query_term<Term>::access != internal::term_access::excluded;
+            if constexpr (!internal::is_tag<T> && hands_out && !internal::query_term<Term>::read_only) {
+                if (const auto pool = std::get<internal::component_allocator<entity_id, T>*>(pools)) {
+                    pool->mark_written();
+                }
+            }
+        }
+
+        template <typename Term>
+        static void add_term_to_masks(query_masks& masks)
+        {
+            constexpr auto access = internal::query_term<Term>::access;
+            if constexpr (access != internal::term_access::optional) {
+                const auto bit = component_bit<internal::component_t<Term>>();
+                masks.care.set(bit);
+                if constexpr (access == internal::term_access::required) {
+                    masks.wanted.set(bit);
+                }
+            }
+        }
+
+        /**
+         * Picks the smallest pool or covering group to drive iteration. If any pool
+         * doesn't exist yet then nothing can match and the view is left empty.
+         */
+        void choose_candidates()
+        {
+            if constexpr (scan_signatures) {
+                end_index = reg.entities.size();
+            } else {
+                // Excluded and optional terms are left out as null
+                const std::array<internal::i_component_allocator<entity_id>*, sizeof...(Types)> all_pools = {
+                    internal::is_required<Types>
+                        ? std::get<internal::component_allocator<entity_id, internal::component_t<Types>>*>(pools)
+                        : nullptr...
+                };
+                constexpr std::array<bool, sizeof...(Types)> skip = {
+                    (internal::is_tag<internal::component_t<Types>> || !internal::is_required<Types>)...
+                };
+                for (std::size_t i = 0; i < all_pools.size(); i++) {
+                    if (all_pools[i] == nullptr && !skip[i]) {
+                        candidates = nullptr;
+                        end_index = 0;
+                        return;
+                    }
+                }
+                if constexpr (internal::has_filters<Types...>) {
+                    (choose_dirty_list<Types>(), ...);
+                    return;
+                }
+                for (const auto pool : all_pools) {
+                    if (pool == nullptr) {
+                        continue;
+                    }
+                    if (candidates == nullptr || pool->size() < end_index) {
+                        candidates = &pool->entities;
+                        end_index = pool->size();
+                    }
+                }
+                for (const auto pool : all_pools) {
+                    const auto owner = pool != nullptr ? pool->owner : nullptr;
+                    if (owner == nullptr || owner->length > end_index || !covered_by_view(owner, all_pools)) {
+                        continue;
+                    }
+                    group = owner;
+                    candidates = &owner->pools[0]->entities;
+                    end_index = owner->length;
+                    exact_group = !has_exclusions && owner->pools.size() == required_count;
+                }
+            }
+        }
+
+        /**
+         * Drives iteration from the dirty list of a filtered term if it's the
+         * shortest so far.
+         */
+        template <typename Term>
+        void choose_dirty_list()
+        {
+            constexpr auto filter = internal::query_term<Term>::filter;
+            if constexpr (filter != internal::term_filter::none) {
+                static_assert(!internal::is_tag<internal::component_t<Term>>, "Tags can't be tracked");
+                const auto pool = std::get<internal::component_allocator<entity_id, internal::component_t<Term>>*>(pools);
+                ADK_ASSERT(pool->tracking);
+                const auto& list = filter == internal::term_filter::added ? pool->added_entities : pool->changed_entities;
+                if (driver_pool == nullptr || list.size() < end_index) {
+                    driver_pool = pool;
+                    driver_filter = filter;
+                    candidates = &list;
+                    end_index = list.size();
+                }
+            }
+        }
+
+        /**
+         * Checks the filtered terms for the current candidate of a dirty list.
+         * The driving term's entry must be the one its change state points to,
+         * which skips stale entries of removed components and duplicates.
+         */
+        bool passes_filters(entity_id entity) const
+        {
+            const bool current = driver_filter == internal::term_filter::added
+                ? driver_pool->is_added(entity, current_index)
+                : driver_pool->is_changed(entity, current_index);
+            return current && (passes_filter<Types>(entity) && ...);
+        }
+
+        template <typename Term>
+        bool passes_filter(entity_id entity) const
+        {
+            constexpr auto filter = internal::query_term<Term>::filter;
+            const auto pool = std::get<internal::component_allocator<entity_id, internal::component_t<Term>>*>(pools);
+            if constexpr (filter == internal::term_filter::added) {
+                return pool->is_added(entity);
+            } else if constexpr (filter == internal::term_filter::changed) {
+                return pool->is_changed(entity);
+            } else {
+                return true;
+            }
+        }
+
+        template <typename Pools>
+        static bool covered_by_view(const internal::group_handler<entity_id>* owner, const Pools& all_pools)
+        {
+            for (const auto owned : owner->pools) {
+                if (std::find(all_pools.begin(), all_pools.end(), owned) == all_pools.end()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Returns what a term adds to the tuple of a match.
+         */
+        template <typename Term>
+        typename internal::query_term<Term>::value get_term(entity_id entity) const
+        {
+            using T = internal::component_t<Term>;
+            constexpr auto access = internal::query_term<Term>::access;
+            if constexpr (access == internal::term_access::required && internal::split_component<T>) {
+                return get_columns<T>(entity, typename internal::query_term<Term>::column_indexes());
+            } else if constexpr (access == internal::term_access::required) {
+                return { get_component<T>(entity) };
+            } else if constexpr (access == internal::term_access::optional) {
+                return { find_component<T>(entity) };
+            } else {
+                return {};
+            }
+        }
+
+        /**
+         * Returns references to the requested members of a split component.
+         */
+        template <typename T, std::size_t... indexes>
+        auto get_columns(entity_id entity, std::index_sequence<indexes...>) const
+        {
+            if constexpr (sizeof...(indexes) == 0) {
+                return std::tuple<>();
+            } else {
+                const auto pool = std::get<internal::component_allocator<entity_id, T>*>(pools);
+                const std::size_t position = &pool->entities == candidates ? current_index : pool->index_of(entity);
+                return std::tuple<internal::column_t<T, indexes>&...>(pool->arr.template column<indexes>()[position]...);
+            }
+        }
+
+        template <typename T>
+        T* find_component(entity_id entity) const
+        {
+            if constexpr (internal::is_tag<T>) {
+                return reg.template has<T>(entity) ? &internal::tag_instance<T>() : nullptr;
+            } else {
+                const auto pool = std::get<internal::component_allocator<entity_id, T>*>(pools);
+                return pool != nullptr && pool->contains(entity) ? &pool->get(entity) : nullptr;
+            }
+        }
+
+        /**
+         * Fetches a component through the pool pointers resolved on construction.
+         * The pool driving iteration is indexed directly.
+         */
+        template <typename T>
+        T& get_component(entity_id entity) const
+        {
+            static_assert(!internal::split_component<T>, "Split components are read through adk::ecs::members");
+            if constexpr (internal::is_tag<T>) {
+                return internal::tag_instance<T>();
+            } else {
+                const auto pool = std::get<internal::component_allocator<entity_id, T>*>(pools);
+                if (&pool->entities == candidates || (group != nullptr && pool->owner == group)) {
+                    return pool->arr[current_index];
+                }
+                return pool->get(entity);
+            }
+        }
+
+        entity_id current_entity() const
+        {
+            if constexpr (scan_signatures) {
+                return reg.entities[current_index];
+            } else {
+                return (*candidates)[current_index];
+            }
+        }
+
+        void find_next_valid()
+        {
+            current_index++;
+            if constexpr (scan_signatures) {
+                scan_next_valid();
+            } else {
+                if (exact_group) {
+                    return;
+                }
+                while (current_index < end_index) {
+                    const auto entity = (*candidates)[current_index];
+                    ADK_ECS_INSTRUMENT(checked++;)
+                    const auto& query = masks();
+                    const auto& entity_signature = reg.signatures[internal::get_entity_index(entity)];
+                    if constexpr (internal::has_filters<Types...>) {
+                        if (passes_filters(entity) && entity_signature.matches(query.care, query.wanted)) {
+                            return;
+                        }
+                    } else if (entity_signature.matches(query.care, query.wanted)) {
+                        return;
+                    }
+                    ADK_ECS_INSTRUMENT(rejected++;)
+                    current_index++;
+                }
+            }
+        }
+
+        /**
+         * Walks the signature array directly, matching a whole block of entities
+         * at a time and then stepping through the set bits.
+         */
+        void scan_next_valid()
+        {
+            while (current_index < end_index) {
+                const std::size_t block = current_index / internal::SIGNATURE_BLOCK;
+                const std::size_t base = block * internal::SIGNATURE_BLOCK;
+                if (block != block_index) {
+                    const std::size_t count = std::min(internal::SIGNATURE_BLOCK, end_index - base);
+                    block_matches = internal::match_signatures(&reg.signatures[base], count, masks().care, masks().wanted);
+                    block_index = block;
+                    ADK_ECS_INSTRUMENT(checked += count; rejected += count - std::popcount(block_matches);)
+                }
+                const std::uint64_t remaining = block_matches >> (current_index - base);
+                if (remaining != 0) {
+                    current_index += std::countr_zero(remaining);
+                    return;
+                }
+                current_index = base + internal::SIGNATURE_BLOCK;
+            }
+            current_index = end_index;
+        }
+    };
+
+    /**
+     * Splits a view into chunks of candidates so it can be iterated by several
+     * threads at once. Each chunk is itself a view, and since every entity
+     * falls in exactly one chunk the component references handed out by
+     * different chunks never alias. Should only be created via factory function.
+     */
+    template <typename... Types>
+    class par_view
+    {
+    public:
+        par_view(registry& reg)
+            : reg(reg),
+              count(view<Types...>(reg).size_hint())
+        {}
+
+        /**
+         * Returns number of chunks.
+         */
+        std::size_t size() const
+        {
+            return (count + chunk_size - 1) / chunk_size;
+        }
+
+        view<Types...> operator[](std::size_t chunk) const
+        {
+            return view<Types...>(reg, chunk * chunk_size, (chunk + 1) * chunk_size);
+        }
+
+        /**
+         * Runs func on every match, with chunks spread over the threads of pool.
+         * func is shared between threads and must be safe to call concurrently.
+         */
+        template <typename Func>
+        void for_each(thread_pool& pool, Func& func) const
+        {
+            ADK_ECS_INSTRUMENT(
+                const auto start = std::chrono::steady_clock::now();
+                std::atomic<std::uint64_t> checked = 0;
+                std::atomic<std::uint64_t> rejected = 0;
+            )
+            auto run_chunks = [&](std::size_t begin, std::size_t end) {
+                for (std::size_t chunk = begin; chunk < end; chunk++) {
+                    auto chunk_view = (*this)[chunk];
+                    chunk_view.each(func);
+                    ADK_ECS_INSTRUMENT(
+                        checked.fetch_add(chunk_view.checked, std::memory_order_relaxed);
+                        rejected.fetch_add(chunk_view.rejected, std::memory_order_relaxed);
+                    )
+                }
+            };
+            pool.parallel_for(size(), 1, run_chunks);
+            ADK_ECS_INSTRUMENT(reg.template record_query<Types...>(start, checked.load(), rejected.load());)
+        }
+
+    private:
+        static constexpr std::size_t chunk_size = internal::parallel_chunk_size<entity_id, Types...>();
+
+        registry& reg;
+        std::size_t count;
+    };
+
+    template <typename Terms>
+    struct view_of;
+
+    template <typename... Terms>
+    struct view_of<std::tuple<Terms...>>
+    {
+        using type = view<Terms...>;
+        using par_type = par_view<Terms...>;
+    };
+
+    /**
+     * View and parallel view types for a list of view parameters, with include,
+     * exclude and optional lists expanded into one term per component.
+     */
+    template <typename... Types>
+    using view_t = typename view_of<internal::flat_terms<Types...>>::type;
+
+    template <typename... Types>
+    using par_view_t = typename view_of<internal::flat_terms<Types...>>::par_type;
+
+    static signature alive_mask()
+    {
+        signature mask;
+        mask.set(signature::alive_bit);
+        return mask;
+    }
+
+    static void add_listener(std::pmr::vector<std::pmr::vector<listener>>& listeners, std::size_t component_id, listener func)
+    {
+        if (component_id >= listeners.size()) {
+            listeners.resize(component_id + 1);
+        }
+        listeners[component_id].push_back(std::move(func));
+    }
+
+    void notify(const std::pmr::vector<std::pmr::vector<listener>>& listeners, std::size_t component_id, entity_id entity)
+    {
+        if (component_id < listeners.size()) {
+            for (const auto& func : listeners[component_id]) {
+                func(*this, entity);
+            }
+        }
+    }
+
+    /**
+     * Copies component into the pool of every passed entity, tags have no pool.
+     */
+    template <typename T>
+    void insert_n(std::span<const entity_id> entities, const T& component)
+    {
+        static_assert(!std::is_same_v<T, relationship_type>, "Hierarchy links are added with set_parent");
+        if constexpr (!internal::is_tag<T>) {
+            component_manager.template assure<T>()->insert_n(entities, component);
+        }
+    }
+
+    template <typename... Types, typename Writer>
+    void write_snapshot(Writer& writer) const
+    {
+        const std::uint32_t header[] = {
+            internal::SNAPSHOT_MAGIC,
+            internal::SNAPSHOT_VERSION,
+            static_cast<std::uint32_t>(sizeof(entity_id)),
+            static_cast<std::uint32_t>(sizeof...(Types)),
+        };
+        writer.write(header, sizeof(header));
+        const std::uint64_t counts[] = { entities.size(), free_count };
+        writer.write(counts, sizeof(counts));
+        writer.write(&free_list, sizeof(free_list));
+        writer.write(entities.data(), entities.size() * sizeof(entity_id));
+        (write_snapshot_type<Types>(writer), ...);
+    }
+
+    /**
+     * Writes the size of T so mismatched types are caught on restore, then its
+     * pool. Tags are written as the list of entities that have them.
+     */
+    template <typename T, typename Writer>
+    void write_snapshot_type(Writer& writer) const
+    {
+        const std::uint32_t size = internal::is_tag<T> ? 0 : sizeof(T);
+        writer.write(&size, sizeof(size));
+        if constexpr (internal::is_tag<T>) {
+            const auto bit = component_bit<T>();
+            std::uint64_t count = 0;
+            for (const auto& entity_signature : signatures) {
+                count += entity_signature.test(bit);
+            }
+            writer.write(&count, sizeof(count));
+            for (std::size_t i = 0; i < signatures.size(); i++) {
+                if (signatures[i].test(bit)) {
+                    writer.write(&entities[i], sizeof(entity_id));
+                }
+            }
+        } else if (const auto pool = component_manager.template find<T>()) {
+            pool->save(writer);
+        } else {
+            const std::uint64_t count = 0;
+            writer.write(&count, sizeof(count));
+        }
+    }
+
+    template <typename... Types, typename Reader>
+    bool read_snapshot(Reader& reader)
+    {
+        std::uint32_t header[4] = {};
+        if (!reader.read(header, sizeof(header))
+                || header[0] != internal::SNAPSHOT_MAGIC
+                || header[1] != internal::SNAPSHOT_VERSION
+                || header[2] != sizeof(entity_id)
+                || header[3] != sizeof...(Types)) {
+            return false;
+        }
+        std::uint64_t counts[2] = {};
+        if (!reader.read(counts, sizeof(counts))
+                || counts[0] > reserved_index
+                || counts[0] > reader.remaining() / sizeof(entity_id)
+                || counts[1] > counts[0]) {
+            return false;
+        }
+
+        // The entity array is read on the side and only swapped in once its
+        // free list checks out, so a bad one leaves the registry as it was
+        std::pmr::vector<entity_id> restored(counts[0], memory.get());
+        entity_id restored_free_list = null_index;
+        if (!reader.read(&restored_free_list, sizeof(restored_free_list))
+                || !reader.read(restored.data(), restored.size() * sizeof(entity_id))) {
+            return false;
+        }
+        entities.swap(restored);
+        std::swap(free_list, restored_free_list);
+        const auto previous_free_count = std::exchange(free_count, counts[1]);
+        if (!valid_free_list()) {
+            entities.swap(restored);
+            free_list = restored_free_list;
+            free_count = previous_free_count;
+            return false;
+        }
+
+        component_manager.clear();
+        for (auto& handler : groups) {
+            handler->length = 0;
+        }
+        signatures.assign(entities.size(), {});
+        for (std::size_t i = 0; i < entities.size(); i++) {
+            if (internal::get_entity_index(entities[i]) == i) {
+                signatures[i] = alive_mask();
+            }
+        }
+        reset_reservations();
+        if (!(read_snapshot_type<Types>(reader) && ...)) {
+            discard_snapshot();
+            return false;
+        }
+
+        for (auto& handler : groups) {
+            for (std::size_t i = 0; i < handler->pools[0]->size(); i++) {
+                handler->on_construct(handler->pools[0]->entities[i]);
+            }
+        }
+        rebuild_hierarchy_levels();
+        return true;
+    }
+
+    /**
+     * Empties the registry after a snapshot failed partway through its
+     * components. Every restored entity is deleted, so its id stays invalid.
+     */
+    void discard_snapshot()
+    {
+        component_manager.clear();
+        for (auto& handler : groups) {
+            handler->length = 0;
+        }
+        hierarchy_ends.clear();
+        for (std::size_t i = 0; i < entities.size(); i++) {
+            if (internal::get_entity_index(entities[i]) == i) {
+                release_slot(entities[i]);
+            }
+        }
+    }
+
+    template <typename T, typename Reader>
+    bool read_snapshot_type(Reader& reader)
+    {
+        std::uint32_t size = 0;
+        if (!reader.read(&size, sizeof(size)) || size != (internal::is_tag<T> ? 0 : sizeof(T))) {
+            return false;
+        }
+        const auto bit = component_bit<T>();
+        if constexpr (internal::is_tag<T>) {
+            std::uint64_t count = 0;
+            if (!reader.read(&count, sizeof(count))) {
+                return false;
+            }
+            for (std::uint64_t i = 0; i < count; i++) {
+                entity_id entity;
+                if (!reader.read(&entity, sizeof(entity)) || !claim_snapshot_entity(entity, bit)) {
+                    return false;
+                }
+            }
+        } else {
+            const auto pool = component_manager.template assure<T>();
+            if (!pool->load(reader, [this, bit](entity_id entity) { return claim_snapshot_entity(entity, bit); })) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Sets the bit of a restored component, rejecting dead entities and ones
+     * that already have it.
+     */
+    bool claim_snapshot_entity(entity_id entity, std::size_t bit)
+    {
+        if (!valid(entity) || signatures[internal::get_entity_index(entity)].test(bit)) {
+            return false;
+        }
+        signatures[internal::get_entity_index(entity)].set(bit);
+        return true;
+    }
+
+    /**
+     * Checks that the free list of a restored entity array links exactly the
+     * free slots, without running out of bounds or in circles.
+     */
+    bool valid_free_list() const
+    {
+        std::size_t free_slots = 0;
+        for (std::size_t i = 0; i < entities.size(); i++) {
+            free_slots += is_free_slot(i);
+        }
+        std::size_t linked = 0;
+        for (auto index = free_list; index != null_index; index = internal::get_entity_index(entities[index])) {
+            if (index >= entities.size() || !is_free_slot(index) || linked == free_slots) {
+                return false;
+            }
+            linked++;
+        }
+        return linked == free_slots && linked == free_count;
+    }
+
+    /**
+     * Adds a finished for_each or par_for_each call to its query's stats.
+     */
+    template <typename... Types>
+    void record_query(std::chrono::steady_clock::time_point start, std::uint64_t checked, std::uint64_t rejected)
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const auto id = internal::get_query_id<Types...>();
+        std::lock_guard lock(instrumentation->mutex);
+        auto& queries = instrumentation->queries;
+        if (id >= queries.size()) {
+            queries.resize(id + 1);
+        }
+        auto& query = queries[id];
+        query.name = internal::type_name<std::tuple<Types...>>();
+        query.candidates += checked;
+        query.rejections += rejected;
+        query.timing.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    /**
+     * Gives the entity a relationship if it doesn't have one yet, as a root.
+     */
+    void assure_node(entity_id entity)
+    {
+        if (has<relationship_type>(entity)) {
+            return;
+        }
+        // The new node lands at the end of the pool, so it starts out in the last level
+        if (hierarchy_ends.empty()) {
+            hierarchy_ends.push_back(0);
+        }
+        hierarchy_ends.back()++;
+        relationship_type node;
+        node.depth = static_cast<std::uint32_t>(hierarchy_ends.size() - 1);
+        signatures[internal::get_entity_index(entity)].set(component_bit<relationship_type>());
+        component_manager.template insert<relationship_type>(entity, std::move(node));
+        move_to_level(entity, 0);
+        notify(construct_listeners, component_bit<relationship_type>(), entity);
+    }
+
+    /**
+     * Moves a node into the level of the passed depth. Every level it crosses
+     * is shifted by one swap at its boundary, so this costs one swap per level
+     * between the old and new depth.
+     */
+    void move_to_level(entity_id entity, std::uint32_t depth)
+    {
+        const auto pool = component_manager.template find<relationship_type>();
+        std::size_t position = pool->index_of(entity);
+        std::uint32_t current = pool->arr[position].depth;
+        if (depth >= hierarchy_ends.size()) {
+            hierarchy_ends.resize(depth + 1, hierarchy_ends.back());
+        }
+        for (; current < depth; current++) {
+            // Swap with the last node of the level and move the boundary before it
+            const std::size_t last = --hierarchy_ends[current];
+            pool->swap_positions(position, last);
+            position = last;
+        }
+        for (; current > depth; current--) {
+            // Swap with the first node of the level and move the boundary after it
+            const std::size_t first = hierarchy_ends[current - 1]++;
+            pool->swap_positions(position, first);
+            position = first;
+        }
+        pool->arr[position].depth = depth;
+        trim_hierarchy_levels();
+    }
+
+    /**
+     * Drops empty levels from the end.
+     */
+    void trim_hierarchy_levels()
+    {
+        while (!hierarchy_ends.empty()
+                && hierarchy_ends.back() == (hierarchy_ends.size() > 1 ? hierarchy_ends[hierarchy_ends.size() - 2] : 0)) {
+            hierarchy_ends.pop_back();
+        }
+    }
+
+    /**
+     * Moves every node of the subtree rooted at entity to its depth below the
+     * passed depth of entity. The subtree is collected first so deep chains
+     * don't recurse.
+     */
+    void set_subtree_depth(entity_id entity, std::uint32_t depth)
+    {
+        if (get<relationship_type>(entity).depth == depth) {
+            return;
+        }
+        // Breadth first, so every node's depth is its parent's plus one
+        hierarchy_scratch.clear();
+        hierarchy_scratch.push_back(entity);
+        for (std::size_t i = 0; i < hierarchy_scratch.size(); i++) {
+            for (auto child = get<relationship_type>(hierarchy_scratch[i]).first_child; child != relationship_type::null;) {
+                hierarchy_scratch.push_back(child);
+                child = get<relationship_type>(child).next_sibling;
+            }
+        }
+        for (const auto node : hierarchy_scratch) {
+            const auto parent = get<relationship_type>(node).parent;
+            move_to_level(node, node == entity ? depth : get<relationship_type>(parent).depth + 1);
+        }
+    }
+
+    /**
+     * Removes a node from its parent's list of children.
+     */
+    void unlink_from_parent(relationship_type& node)
+    {
+        if (node.parent == relationship_type::null) {
+            return;
+        }
+        if (node.prev_sibling != relationship_type::null) {
+            get<relationship_type>(node.prev_sibling).next_sibling = node.next_sibling;
+        } else {
+            get<relationship_type>(node.parent).first_child = node.next_sibling;
+        }
+        if (node.next_sibling != relationship_type::null) {
+            get<relationship_type>(node.next_sibling).prev_sibling = node.prev_sibling;
+        }
+        node.parent = relationship_type::null;
+        node.prev_sibling = relationship_type::null;
+        node.next_sibling = relationship_type::null;
+    }
+
+    /**
+     * Takes a node that's about to be deleted out of the hierarchy, its
+     * children become roots. The node is left at the end of the relationship
+     * pool, outside of every level, so removing it moves nothing else.
+     */
+    void detach_node(entity_id entity)
+    {
+        auto& node = get<relationship_type>(entity);
+        unlink_from_parent(node);
+        auto child = node.first_child;
+        node.first_child = relationship_type::null;
+        // Moving the children swaps nodes around, so nothing is held by reference
+        while (child != relationship_type::null) {
+            auto& child_node = get<relationship_type>(child);
+            const auto next = child_node.next_sibling;
+            child_node.parent = relationship_type::null;
+            child_node.prev_sibling = relationship_type::null;
+            child_node.next_sibling = relationship_type::null;
+            set_subtree_depth(child, 0);
+            child = next;
+        }
+
+        move_to_level(entity, static_cast<std::uint32_t>(hierarchy_ends.size() - 1));
+        const auto pool = component_manager.template find<relationship_type>();
+        pool->swap_positions(pool->index_of(entity), --hierarchy_ends.back());
+        trim_hierarchy_levels();
+    }
+
+    /**
+     * Sorts the relationship pool by depth and recounts the levels, used after
+     * the pool was replaced.
+     */
+    void rebuild_hierarchy_levels()
+    {
+        hierarchy_ends.clear();
+        const auto pool = component_manager.template find<relationship_type>();
+        if (pool == nullptr) {
+            return;
+        }
+        pool->sort([](const relationship_type& a, const relationship_type& b) { return a.depth < b.depth; });
+        for (std::size_t i = 0; i < pool->size(); i++) {
+            const auto depth = pool->arr[i].depth;
+            if (depth >= hierarchy_ends.size()) {
+                hierarchy_ends.resize(depth + 1, i);
+            }
+            hierarchy_ends[depth] = i + 1;
+        }
+    }
+
+    /**
+     * Pops a slot off of the free list and returns its new id.
+     */
+    entity_id reuse_slot()
+    {
+        const auto index = free_list;
+        free_list = internal::get_entity_index(entities[index]);
+        entities[index] = internal::set_entity_index(entities[index], index);
+        free_count--;
+        return entities[index];
+    }
+
+    /**
+     * Creates an entity with the passed signature for every slot of out. Ids are
+     * taken from the free list first and the rest are reserved in one go.
+     */
+    void allocate_entities(std::span<entity_id> out, const signature& mask)
+    {
+        std::size_t i = 0;
+        for (; i < out.size() && free_list != null_index; i++) {
+            out[i] = reuse_slot();
+            signatures[internal::get_entity_index(out[i])] = mask;
+        }
+
+        const std::size_t remaining = out.size() - i;
+        if (remaining == 0) {
+            return;
+        }
+        const std::size_t first = claim_indexes(remaining);
+        for (std::size_t j = 0; j < remaining; j++) {
+            out[i + j] = fresh_entity(first + j);
+            fill_reserved_slot(out[i + j], mask);
+        }
+    }
+
+    /**
+     * Takes count consecutive indexes past every one in use, shared with
+     * reserve_entity, and returns the first. Their slots and any skipped ones
+     * are left reserved.
+     */
+    std::size_t claim_indexes(std::size_t count)
+    {
+        const auto first = reservations->next_index.fetch_add(count, std::memory_order_relaxed);
+        check_index_capacity(first + count);
+        grow_slots(first + count);
+        return first;
+    }
+
+    /**
+     * Appends reserved slots until there are size of them.
+     */
+    void grow_slots(std::size_t size)
+    {
+        if (size > entities.size()) {
+            reserved_count += size - entities.size();
+            for (std::size_t i = entities.size(); i < size; i++) {
+                entities.push_back(internal::set_entity_index(fresh_entity(i), reserved_index));
+            }
+            signatures.resize(size);
+        }
+    }
+
+    /**
+     * Returns the id an index that has never been handed out gets, see
+     * reservation_state::trimmed_version.
+     */
+    entity_id fresh_entity(std::size_t index) const
+    {
+        const auto& state = *reservations;
+        const entity_id version = index < state.trimmed_end.load(std::memory_order_relaxed)
+            ? state.trimmed_version.load(std::memory_order_relaxed) : 0;
+        return internal::set_entity_version(internal::set_entity_index<entity_id>(0, static_cast<entity_id>(index)), version);
+    }
+
+    /**
+     * Aborts once entity indexes would reach reserved_index. Checked in every
+     * build, past it new entities would read as reserved or invalid.
+     */
+    static void check_index_capacity(std::size_t end)
+    {
+        if (end > reserved_index) [[unlikely]] {
+            std::fprintf(stderr, "adk::ecs: out of entity indexes, use a wider entity_id\n");
+            std::abort();
+        }
+    }
+
+    bool is_reserved_slot(std::size_t index) const
+    {
+        return internal::get_entity_index(entities[index]) == reserved_index;
+    }
+
+    void fill_reserved_slot(entity_id entity, const signature& mask)
+    {
+        const auto index = internal::get_entity_index(entity);
+        ADK_ASSERT(is_reserved_slot(index));
+        ADK_ASSERT(internal::get_entity_version(entities[index]) == internal::get_entity_version(entity));
+        entities[index] = entity;
+        signatures[index] = mask;
+        reserved_count--;
+    }
+
+    bool is_free_slot(std::size_t index) const
+    {
+        return !is_reserved_slot(index) && internal::get_entity_index(entities[index]) != index;
+    }
+
+    /**
+     * Trims free slots off the end of the entity array and rebuilds the free
+     * list in ascending order of index.
+     */
+    void compact_entities()
+    {
+        flush_reserved();
+        // Trimmed slots hand their next version on to trimmed_version. While
+        // indexes past the end still come back with it, it can't be raised
+        // without racing threads that claim them, so only slots it covers go.
+        auto& state = *reservations;
+        const auto trimmed_end = state.trimmed_end.load(std::memory_order_relaxed);
+        const auto trimmed_version = state.trimmed_version.load(std::memory_order_relaxed);
+        std::size_t end = entities.size();
+        while (end > 0 && is_free_slot(end - 1)
+                && (trimmed_end <= entities.size() || internal::get_entity_version(entities[end - 1]) <= trimmed_version)) {
+            end--;
+        }
+        if (end < entities.size() && trimmed_end <= entities.size()) {
+            entity_id version = trimmed_version;
+            for (std::size_t i = end; i < entities.size(); i++) {
+                version = std::max(version, internal::get_entity_version(entities[i]));
+            }
+            state.trimmed_version.store(version, std::memory_order_relaxed);
+            state.trimmed_end.store(entities.size(), std::memory_order_relaxed);
+        }
+        // Indexes can only be given back if no thread has claimed one past them
+        auto expected = entities.size();
+        if (end < entities.size() && state.next_index.compare_exchange_strong(expected, end, std::memory_order_release)) {
+            entities.resize(end);
+            signatures.resize(end);
+            flushed_index = end;
+        }
+        entities.shrink_to_fit();
+        signatures.shrink_to_fit();
+
+        free_list = null_index;
+        free_count = 0;
+        for (std::size_t i = entities.size(); i-- > 0;) {
+            if (is_free_slot(i)) {
+                entities[i] = internal::set_entity_index(entities[i], free_list);
+                free_list = static_cast<entity_id>(i);
+                free_count++;
+            }
+        }
+
+        hierarchy_ends.shrink_to_fit();
+        hierarchy_scratch.shrink_to_fit();
+    }
+
+    /**
+     * Drops every reservation after the entity array has been replaced. Slots
+     * that were set aside when it was saved go back on the free list with the
+     * version they were reserved with.
+     */
+    void reset_reservations()
+    {
+        auto& state = *reservations;
+        state.head.store(0, std::memory_order_relaxed);
+        state.tail.store(0, std::memory_order_relaxed);
+        state.next_index.store(entities.size(), std::memory_order_relaxed);
+        flushed_head = 0;
+        flushed_index = entities.size();
+        reserved_count = 0;
+        for (std::size_t i = 0; i < entities.size(); i++) {
+            if (is_reserved_slot(i)) {
+                entities[i] = internal::set_entity_index(entities[i], free_list);
+                free_list = static_cast<entity_id>(i);
+                free_count++;
+            }
+        }
+    }
+
+    /**
+     * Pushes the slot of a deleted entity onto the free list, bumping its version.
+     */
+    void release_slot(entity_id entity)
+    {
+        const auto index = internal::get_entity_index(entity);
+        const auto version = static_cast<entity_id>(internal::get_entity_version(entity) + 1);
+        entities[index] = internal::set_entity_version(internal::set_entity_index<entity_id>(0, free_list), version);
+        signatures[index] = {};
+        free_list = index;
+        free_count++;
+    }
+
+public:
+    using entity_id_type = entity_id;
+
+    /**
+     * Constructs an empty registry that takes all of its memory from upstream,
+     * which must outlive it.
+     */
+    explicit registry(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : memory(internal::make_resource_ptr<counting_resource>(upstream, upstream)),
+          component_manager(memory.get()),
+          entities(memory.get()),
+          signatures(memory.get()),
+          reservations(internal::make_resource_ptr<internal::reservation_state<entity_id>>(memory.get())),
+          groups(memory.get()),
+          hierarchy_ends(memory.get()),
+          hierarchy_scratch(memory.get()),
+          construct_listeners(memory.get()),
+          destroy_listeners(memory.get()),
+          resources(memory.get())
+    {}
+
+    registry(registry&&) = default;
+
+    // Containers can't be moved between resources without copying, so
+    // registries are only move constructible.
+    registry& operator=(registry&&) = delete;
+
+    /**
+     * Returns how much memory the registry currently holds, at most held
+     * and how many allocations it has made.
+     */
+    const memory_stats& memory_usage() const
+    {
+        return memory->stats();
+    }
+
+    /**
+     * Collects entity counts, memory use and the size of every pool. When
+     * ADK_ECS_INSTRUMENTATION is defined it also includes timings and
+     * rejection counts of each for_each and par_for_each parameter list.
+     * Not meant to be called every frame, it allocates.
+     */
+    registry_stats stats() const
+    {
+        registry_stats result;
+        result.entity_slots = entities.size();
+        result.free_slots = free_count;
+        result.live_entities = entities.size() - free_count - reserved_count;
+        result.memory = memory_usage();
+        component_manager.for_each_allocator([&result](std::size_t id, const internal::i_component_allocator<entity_id>& pool) {
+            result.pools.push_back({ id, pool.name, pool.size(), pool.capacity(), pool.memory_bytes() });
+        });
+        std::lock_guard lock(instrumentation->mutex);
+        for (const auto& query : instrumentation->queries) {
+            if (query.timing.count > 0) {
+                result.view_candidates += query.candidates;
+                result.view_rejections += query.rejections;
+                result.queries.push_back(query);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Returns the resource the registry was constructed with.
+     */
+    std::pmr::memory_resource* upstream_resource() const
+    {
+        return memory->upstream_resource();
+    }
+
+    /**
+     * Constructs new entity_id and handles populating deleted entities,
+     * as well as creating brand new ones.
+     */
+    entity_id new_entity()
+    {
+        if (free_list != null_index) {
+            const auto entity = reuse_slot();
+            signatures[internal::get_entity_index(entity)] = alive_mask();
+            return entity;
+        }
+        
+        const auto index = claim_indexes(1);
+        const auto entity = fresh_entity(index);
+        fill_reserved_slot(entity, alive_mask());
+        return entity;
+    }
+
+    /**
+     * Returns an id for a new entity without touching the registry's arrays, so
+     * any number of threads can call it while the registry is in use, as long as
+     * it isn't being restored, moved or destroyed. Free slots set aside by the
+     * last flush_reserved are handed out first, then indexes past every one in
+     * use. The entity isn't valid until the next flush_reserved, but its id can
+     * be recorded in command buffers since playback flushes first.
+     */
+    entity_id reserve_entity()
+    {
+        auto& state = *reservations;
+        auto head = state.head.load(std::memory_order_acquire);
+        while (head < state.tail.load(std::memory_order_acquire)) {
+            const auto entity = state.slots[head % internal::RESERVED_SLOTS].load(std::memory_order_relaxed);
+            if (state.head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) {
+                return entity;
+            }
+        }
+        // Acquire pairs with compact giving indexes back, so a trimmed one
+        // comes with its version
+        const auto index = state.next_index.fetch_add(1, std::memory_order_acquire);
+        check_index_capacity(index + 1);
+        return fresh_entity(index);
+    }
+
+    /**
+     * Sets the registry's single instance of T, such as frame time or input
+     * state, destroying the previous one if any once the new one is built,
+     * so the arguments can refer to it. Resources belong to the
+     * registry rather than an entity, so views and snapshots don't see
+     * them. References stay valid until the resource is replaced or removed.
+     */
+    template <typename T, typename... Args>
+    T& set_resource(Args&&... args)
+    {
+        return resources.emplace<T>(internal::get_resource_id<T>(), std::forward<Args>(args)...);
+    }
+
+    /**
+     * Returns the resource of type T, which must have been set.
+     */
+    template <typename T>
+    T& resource()
+    {
+        const auto value = resources.find(internal::get_resource_id<T>());
+        ADK_ASSERT(value != nullptr);
+        return *static_cast<T*>(value);
+    }
+
+    template <typename T>
+    const T& resource() const
+    {
+        const auto value = resources.find(internal::get_resource_id<T>());
+        ADK_ASSERT(value != nullptr);
+        return *static_cast<const T*>(value);
+    }
+
+    /**
+     * Returns the resource of type T or null if it hasn't been set.
+     */
+    template <typename T>
+    T* try_resource()
+    {
+        return static_cast<T*>(resources.find(internal::get_resource_id<T>()));
+    }
+
+    template <typename T>
+    const T* try_resource() const
+    {
+        return static_cast<const T*>(resources.find(internal::get_resource_id<T>()));
+    }
+
+    template <typename T>
+    void remove_resource()
+    {
+        resources.erase(internal::get_resource_id<T>());
+    }
+
+    /**
+     * Gives memory left over from deleted entities and components back to the
+     * memory resource, a step at a time for as long as budget allows with at
+     * least one step per call. Returns true once a whole pass is done, the next
+     * call starts a new one.
+     *
+     * The first step trims free slots off the end of the entity array, which
+     * also shortens scans over it, and reorders the free list so that new
+     * entities fill the lowest free slots and later passes can trim more.
+     * Entity ids never change, and trimmed indexes come back with a version
+     * past the ones they had so old ids stay invalid. Each following step
+     * shrinks one pool.
+     */
+    bool compact(std::chrono::nanoseconds budget = std::chrono::nanoseconds::max())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (true) {
+            if (compact_step == 0) {
+                compact_entities();
+            } else if (const auto pool = component_manager.find(compact_step - 1)) {
+                pool->shrink();
+            }
+            compact_step++;
+            if (compact_step > component_manager.id_count()) {
+                compact_step = 0;
+                return true;
+            }
+            if (std::chrono::steady_clock::now() - start >= budget) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * Makes every entity reserved so far valid, with no components, then sets
+     * aside as many free slots for the next reservations as were reserved this
+     * time. Must be called from the thread that owns the registry, reserving
+     * threads don't have to stop meanwhile.
+     */
+    void flush_reserved()
+    {
+        auto& state = *reservations;
+        const auto head = state.head.load(std::memory_order_acquire);
+        std::size_t flushed = head - flushed_head;
+        for (; flushed_head < head; flushed_head++) {
+            fill_reserved_slot(state.slots[flushed_head % internal::RESERVED_SLOTS].load(std::memory_order_relaxed), alive_mask());
+        }
+
+        const auto end = state.next_index.load(std::memory_order_relaxed);
+        grow_slots(end);
+        for (; flushed_index < end; flushed_index++) {
+            // Indexes claimed by this thread have been filled already
+            if (is_reserved_slot(flushed_index)) {
+                fill_reserved_slot(fresh_entity(flushed_index), alive_mask());
+                flushed++;
+            }
+        }
+
+        const std::size_t stocked = state.tail.load(std::memory_order_relaxed) - head;
+        std::size_t restock = std::min(flushed, internal::RESERVED_SLOTS - stocked);
+        for (; restock > 0 && free_list != null_index; restock--) {
+            // The slot keeps its version so that a restore or reset that drops
+            // the reservation frees it without reviving older ids
+            const auto entity = reuse_slot();
+            entities[internal::get_entity_index(entity)] = internal::set_entity_index(entity, reserved_index);
+            reserved_count++;
+            const auto tail = state.tail.load(std::memory_order_relaxed);
+            state.slots[tail % internal::RESERVED_SLOTS].store(entity, std::memory_order_relaxed);
+            state.tail.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Creates an entity for every slot of out and writes their ids to it, each
+     * one gets a copy of the passed components. Ids are taken from the free list
+     * first and the rest are reserved in one go, components are inserted one
+     * pool at a time.
+     */
+    template <typename... Types>
+    void create_n(std::span<entity_id> out, const Types&... components)
+    {
+        signature mask = alive_mask();
+        (mask.set(component_bit<Types>()), ...);
+        allocate_entities(out, mask);
+
+        (insert_n(out, components), ...);
+        if (sizeof...(Types) > 0 && !construct_listeners.empty()) {
+            for ([[maybe_unused]] const auto entity : out) {
+                (notify(construct_listeners, component_bit<Types>(), entity), ...);
+            }
+        }
+    }
+
+    /**
+     * Creates count entities with a copy of the passed components and returns their ids.
+     */
+    template <typename... Types>
+    std::vector<entity_id> create_n(std::size_t count, const Types&... components)
+    {
+        std::vector<entity_id> ids(count);
+        create_n(std::span<entity_id>(ids), components...);
+        return ids;
+    }
+
+    /**
+     * Creates an entity for every slot of out, each with a copy of the prefab's
+     * components, and writes their ids to it. The signature of every entity is
+     * written once and each component is copied into its pool in one batch.
+     */
+    void instantiate(const prefab<entity_id, max_components>& source, std::span<entity_id> out)
+    {
+        signature mask = alive_mask();
+        mask |= source.mask;
+        allocate_entities(out, mask);
+        for (const auto& entry : source.entries) {
+            if (entry.ops->insert_n != nullptr) {
+                entry.ops->insert_n(component_manager, out, entry.value);
+            }
+        }
+        if (!construct_listeners.empty()) {
+            for (const auto& entry : source.entries) {
+                for (const auto entity : out) {
+                    notify(construct_listeners, entry.component_id, entity);
+                }
+            }
+        }
+    }
+
+    /**
+     * Creates count entities from the prefab and returns their ids.
+     */
+    std::vector<entity_id> instantiate(const prefab<entity_id, max_components>& source, std::size_t count)
+    {
+        std::vector<entity_id> ids(count);
+        instantiate(source, std::span<entity_id>(ids));
+        return ids;
+    }
+    
+    /**
+     * Destroys the entity's components and puts its slot on the free list.
+     */
+    void delete_entity(entity_id entity)
+    {
+        ADK_ASSERT(valid(entity));
+        if (!destroy_listeners.empty()) {
+            signatures[internal::get_entity_index(entity)].for_each_component([this, entity](std::size_t component_id) {
+                notify(destroy_listeners, component_id, entity);
+            });
+        }
+        // Without any levels there are no nodes, which also keeps registries
+        // that never use the hierarchy from registering its component id
+        if (!hierarchy_ends.empty() && has<relationship_type>(entity)) {
+            detach_node(entity);
+        }
+        signatures[internal::get_entity_index(entity)].for_each_component([this, entity](std::size_t component_id) {
+            if (const auto pool = component_manager.find(component_id)) {
+                pool->entity_destroyed(entity);
+            }
+        });
+        release_slot(entity);
+    }
+
+    /**
+     * Deletes every passed entity, components are removed one pool at a time.
+     * An entity that's passed more than once is only deleted once. Destroy
+     * listeners run for the whole range before any component is removed.
+     */
+    void destroy_range(std::span<const entity_id> range)
+    {
+        signature combined;
+        for (const auto entity : range) {
+            ADK_ASSERT(valid(entity));
+            combined |= signatures[internal::get_entity_index(entity)];
+        }
+        if (!destroy_listeners.empty()) {
+            // Sorted so duplicates are only notified once
+            std::pmr::vector<entity_id> unique(range.begin(), range.end(), memory.get());
+            std::sort(unique.begin(), unique.end());
+            unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+            for (const auto entity : unique) {
+                signatures[internal::get_entity_index(entity)].for_each_component([this, entity](std::size_t component_id) {
+                    notify(destroy_listeners, component_id, entity);
+                });
+            }
+        }
+        combined.for_each_component([this, range](std::size_t component_id) {
+            const auto pool = component_manager.find(component_id);
+            // Checked against the hierarchy first so registries that never use
+            // it don't register a component id for it
+            const bool hierarchy_nodes = !hierarchy_ends.empty() && component_id == component_bit<relationship_type>();
+            for (const auto entity : range) {
+                // The bit is cleared once the component is gone, which skips duplicates
+                auto& entity_signature = signatures[internal::get_entity_index(entity)];
+                if (!entity_signature.test(component_id)) {
+                    continue;
+                }
+                if (hierarchy_nodes) {
+                    detach_node(entity);
+                }
+                if (pool != nullptr) {
+                    pool->entity_destroyed(entity);
+                }
+                entity_signature.reset(component_id);
+            }
+        });
+        for (const auto entity : range) {
+            if (valid(entity)) {
+                release_slot(entity);
+            }
+        }
+    }
+    
+    /**
+     * Returns whether or not the passed id refers to a live entity.
+     */
+    bool valid(entity_id entity) const
+    {
+        const auto index = internal::get_entity_index(entity);
+        return index < entities.size() && entities[index] == entity;
+    }
+
+    /**
+     * Returns whether or not the entity has the component of type T.
+     * T must be a valid component type as passing it here will affect
+     * a global component state.
+     */
+    template <typename T>
+    bool has(entity_id entity) const
+    {
+        return signatures[internal::get_entity_index(entity)].test(component_bit<T>());
+    }
+    
+    /**
+     * Adds a component to passed entity and returns a reference to the 
+     * registry-owned version of it, the component is moved in when passed an
+     * rvalue and copied otherwise. Tags only set the entity's signature bit
+     * and return a shared instance, split components return nothing.
+     * Relationships can't be assigned, see set_parent.
+     */
+    template <typename T, typename Arg = T>
+    decltype(auto) assign(entity_id entity, Arg&& component)
+    {
+        static_assert(!std::is_same_v<T, relationship_type>, "Hierarchy links are added with set_parent");
+        ADK_ASSERT(!has<T>(entity));
+        signatures[internal::get_entity_index(entity)].set(component_bit<T>());
+        if constexpr (internal::is_tag<T>) {
+            notify(construct_listeners, component_bit<T>(), entity);
+            return internal::tag_instance<T>();
+        } else if constexpr (internal::split_component<T>) {
+            component_manager.template insert<T>(entity, std::forward<Arg>(component));
+            notify(construct_listeners, component_bit<T>(), entity);
+        } else {
+            auto& result = component_manager.template insert<T>(entity, std::forward<Arg>(component));
+            if (!construct_listeners.empty()) {
+                notify(construct_listeners, component_bit<T>(), entity);
+                return component_manager.template get<T>(entity);
+            }
+            return result;
+        }
+    }
+    
+    /**
+     * Removes a component from an entity.
+     */
+    template <typename T>
+    void unassign(entity_id entity)
+    {
+        ADK_ASSERT(has<T>(entity));
+        notify(destroy_listeners, component_bit<T>(), entity);
+        if constexpr (std::is_same_v<T, relationship_type>) {
+            detach_node(entity);
+        }
+        signatures[internal::get_entity_index(entity)].reset(component_bit<T>());
+        if constexpr (!internal::is_tag<T>) {
+            component_manager.template destroy<T>(entity);
+        }
+    }
+    
+    /**
+     * Makes parent the parent of child, passing relationship<entity_id>::null
+     * makes child a root. Both entities get a relationship component if they
+     * don't have one yet, and child is moved along with its subtree to the
+     * depth under its new parent. Parent must not be child or one of its
+     * descendants.
+     *
+     * Deleting a node makes its children roots.
+     */
+    void set_parent(entity_id child, entity_id parent)
+    {
+        ADK_ASSERT(valid(child));
+        assure_node(child);
+        std::uint32_t depth = 0;
+        if (parent != relationship_type::null) {
+            ADK_ASSERT(valid(parent));
+            assure_node(parent);
+            for (auto ancestor = parent; ancestor != relationship_type::null;) {
+                ADK_ASSERT(ancestor != child);
+                ancestor = get<relationship_type>(ancestor).parent;
+            }
+            depth = get<relationship_type>(parent).depth + 1;
+        }
+
+        auto& node = get<relationship_type>(child);
+        unlink_from_parent(node);
+        if (parent != relationship_type::null) {
+            auto& parent_node = get<relationship_type>(parent);
+            node.parent = parent;
+            node.next_sibling = parent_node.first_child;
+            if (parent_node.first_child != relationship_type::null) {
+                get<relationship_type>(parent_node.first_child).prev_sibling = child;
+            }
+            parent_node.first_child = child;
+        }
+        set_subtree_depth(child, depth);
+    }
+
+    /**
+     * Returns the parent of the entity, or relationship<entity_id>::null if it
+     * has none.
+     */
+    entity_id parent_of(entity_id entity)
+    {
+        return has<relationship_type>(entity) ? get<relationship_type>(entity).parent : relationship_type::null;
+    }
+
+    /**
+     * Calls func with every direct child of the entity.
+     */
+    template <typename Func>
+    void for_each_child(entity_id entity, Func func)
+    {
+        if (!has<relationship_type>(entity)) {
+            return;
+        }
+        for (auto child = get<relationship_type>(entity).first_child; child != relationship_type::null;) {
+            const auto next = get<relationship_type>(child).next_sibling;
+            func(child);
+            child = next;
+        }
+    }
+
+    /**
+     * Calls func with every hierarchy node and its relationship, depth by depth
+     * so that each parent is visited before its children, which is the order
+     * transforms need to be propagated in. This is a linear walk of the
+     * relationship pool. func must not change the hierarchy.
+     */
+    template <typename Func>
+    void for_each_node(Func func)
+    {
+        const auto pool = component_manager.template find<relationship_type>();
+        if (pool == nullptr) {
+            return;
+        }
+        for (std::size_t i = 0; i < pool->size(); i++) {
+            func(pool->entities[i], std::as_const(pool->arr[i]));
+        }
+    }
+
+    /**
+     * Returns the nodes at the passed depth, in no particular order. The span
+     * is invalidated by any change to the hierarchy.
+     */
+    std::span<const entity_id> hierarchy_level(std::size_t depth) const
+    {
+        const auto pool = component_manager.template find<relationship_type>();
+        if (pool == nullptr || depth >= hierarchy_ends.size()) {
+            return {};
+        }
+        const std::size_t first = depth == 0 ? 0 : hierarchy_ends[depth - 1];
+        return std::span<const entity_id>(pool->entities).subspan(first, hierarchy_ends[depth] - first);
+    }
+
+    /**
+     * Returns number of depths that have nodes.
+     */
+    std::size_t hierarchy_depth() const
+    {
+        return hierarchy_ends.size();
+    }
+
+    /**
+     * Returns a reference to registry-owned component held by passed entity,
+     * or a copy of it for split components.
+     * Expects that entity does contain component.
+     *
+     * The pool counts as written, see extract_buffer. get<const T> returns a
+     * const reference and doesn't.
+     */
+    template <typename T>
+    decltype(auto) get(entity_id entity)
+    {
+        if constexpr (std::is_const_v<T>) {
+            return std::as_const(*this).template get<std::remove_const_t<T>>(entity);
+        } else {
+            ADK_ASSERT(has<T>(entity));
+            if constexpr (internal::is_tag<T>) {
+                return internal::tag_instance<T>();
+            } else {
+                const auto pool = component_manager.template find<T>();
+                if constexpr (!internal::split_component<T>) {
+                    pool->mark_written();
+                }
+                return pool->get(entity);
+            }
+        }
+    }
+
+    /**
+     * Returns a const reference to the entity's component, or a copy of it for
+     * split components. Doesn't count as a write of the pool.
+     */
+    template <typename T>
+    decltype(auto) get(entity_id entity) const
+    {
+        ADK_ASSERT(has<T>(entity));
+        if constexpr (internal::is_tag<T>) {
+            return std::as_const(internal::tag_instance<T>());
+        } else {
+            return component_manager.template find<T>()->get(entity);
+        }
+    }
+    
+    /**
+     * Calls func with the entity's component of type T and marks it as changed,
+     * then returns a reference to it. Split components are put together for
+     * func and written back after, nothing is returned for them.
+     */
+    template <typename T, typename Func>
+    decltype(auto) patch(entity_id entity, Func func)
+    {
+        ADK_ASSERT(has<T>(entity));
+        if constexpr (internal::is_tag<T>) {
+            func(internal::tag_instance<T>());
+            return internal::tag_instance<T>();
+        } else if constexpr (internal::split_component<T>) {
+            const auto pool = component_manager.template find<T>();
+            const auto index = pool->index_of(entity);
+            auto component = pool->arr.get(index);
+            func(component);
+            pool->arr.set(index, std::move(component));
+            pool->mark_written();
+            pool->mark_changed(entity);
+        } else {
+            const auto pool = component_manager.template find<T>();
+            auto& component = pool->get(entity);
+            func(component);
+            pool->mark_written();
+            pool->mark_changed(entity);
+            return component;
+        }
+    }
+
+    /**
+     * Marks the entity's component of type T as changed and returns a reference to it.
+     */
+    template <typename T>
+    T& patch(entity_id entity)
+    {
+        static_assert(!internal::split_component<T>, "Split components have no reference to return");
+        return patch<T>(entity, [](T&) {});
+    }
+
+    /**
+     * Starts recording which components of type T are added, patched and removed,
+     * so they can be iterated with added<T> and changed<T> view parameters and
+     * removed<T>(). Components that already exist are not counted as added.
+     */
+    template <typename T>
+    void track()
+    {
+        static_assert(!internal::is_tag<T>, "Tags can't be tracked");
+        component_manager.template assure<T>()->enable_tracking();
+    }
+
+    /**
+     * Returns the entities that lost their component of type T since changes
+     * were last cleared, some of them may no longer be valid.
+     */
+    template <typename T>
+    std::span<const entity_id> removed()
+    {
+        const auto pool = component_manager.template find<T>();
+        ADK_ASSERT(pool != nullptr && pool->tracking);
+        return pool->removed_entities;
+    }
+
+    /**
+     * Forgets the recorded changes of components of type T.
+     */
+    template <typename T>
+    void clear_changes()
+    {
+        if (const auto pool = component_manager.template find<T>()) {
+            pool->clear_changes();
+        }
+    }
+
+    /**
+     * Forgets the recorded changes of every tracked component type, typically
+     * called once per frame after the reactive systems have run.
+     */
+    void clear_changes()
+    {
+        component_manager.clear_changes();
+    }
+
+    /**
+     * Registers a callback that's called with the registry and the entity right
+     * after a component of type T is added to it.
+     */
+    template <typename T>
+    void on_construct(listener func)
+    {
+        add_listener(construct_listeners, component_bit<T>(), std::move(func));
+    }
+
+    /**
+     * Registers a callback that's called with the registry and the entity right
+     * before its component of type T is removed, including when it's deleted.
+     * Deleting runs every destroy callback of the entity, or of the whole
+     * range for destroy_range, before any of its components are removed, so
+     * callbacks can still read the other components. The callback must not
+     * add or remove components.
+     */
+    template <typename T>
+    void on_destroy(listener func)
+    {
+        add_listener(destroy_listeners, component_bit<T>(), std::move(func));
+    }
+
+    /**
+     * Reorders the pool of T so that iterating it visits components in the order
+     * given by compare, which is called with two components like std::sort's.
+     * Nearly sorted pools are cheap to sort again, so this can run every frame.
+     * The pool must not be owned by a group.
+     */
+    template <typename T, typename Compare>
+    void sort(Compare compare)
+    {
+        static_assert(!internal::is_tag<T>, "Tags have no pool to sort");
+        static_assert(!internal::split_component<T>, "Split components can't be compared, sort another pool and follow it");
+        static_assert(!std::is_same_v<T, relationship_type>, "The registry keeps the relationship pool sorted by depth");
+        if (const auto pool = component_manager.template find<T>()) {
+            ADK_ASSERT(pool->owner == nullptr);
+            pool->sort(compare);
+        }
+    }
+
+    /**
+     * Reorders the pool of U to follow the order of the pool of T. Entities that
+     * have both are moved to the front of U's pool, in the order they have in
+     * T's, so views over both walk the two pools in step. U's pool must not be
+     * owned by a group.
+     */
+    template <typename T, typename U>
+    void sort()
+    {
+        static_assert(!internal::is_tag<T> && !internal::is_tag<U>, "Tags have no pool to sort");
+        static_assert(!std::is_same_v<U, relationship_type>, "The registry keeps the relationship pool sorted by depth");
+        const auto pool = component_manager.template find<T>();
+        const auto other = component_manager.template find<U>();
+        if (pool != nullptr && other != nullptr) {
+            ADK_ASSERT(other->owner == nullptr);
+            other->sort_as(*pool);
+        }
+    }
+
+    /**
+     * Returns the packed entities of a split component's pool followed by the
+     * requested member columns, indexed by the members' order in
+     * ADK_REFLECT_CLASS. Element i of every span belongs to entity i, so loops
+     * over the columns only touch the members they use:
+     *
+     *     auto [ids, x, vx] = reg.columns<particle, 0, 3>();
+     *     for (std::size_t i = 0; i < ids.size(); i++) x[i] += vx[i] * dt;
+     *
+     * Writing through the spans doesn't mark components as changed. The spans
+     * are invalidated by adding or removing T. They always cover the whole
+     * pool, to join the columns with other components or filters use a view
+     * with adk::ecs::members instead.
+     */
+    template <typename T, std::size_t... Columns>
+    std::tuple<std::span<const entity_id>, std::span<internal::column_t<T, Columns>>...> columns()
+    {
+        static_assert(internal::split_component<T>, "Only split components are stored in columns");
+        const auto pool = component_manager.template find<T>();
+        if (pool == nullptr) {
+            return {};
+        }
+        pool->mark_written();
+        return { std::span<const entity_id>(pool->entities), std::span(pool->arr.template column<Columns>())... };
+    }
+
+    /**
+     * Writes the entities, the free list and the pools of the passed component
+     * types to buffer, replacing its contents. The buffer's capacity is reused so
+     * keeping one buffer per saved frame avoids allocating once it has grown.
+     *
+     * Trivially copyable components are copied as raw blocks, other types must
+     * have adk_reflect metadata and are written member by member. Snapshots
+     * are only meant to be restored by the same build on the same platform.
+     * Reserved entities that haven't been flushed are restored as free slots.
+     */
+    template <typename... Types>
+    void snapshot(std::vector<std::byte>& buffer) const
+    {
+        buffer.clear();
+        internal::buffer_writer writer{ buffer };
+        write_snapshot<Types...>(writer);
+    }
+
+    template <typename... Types>
+    void snapshot(std::ostream& stream) const
+    {
+        internal::stream_writer writer{ stream };
+        write_snapshot<Types...>(writer);
+    }
+
+    /**
+     * Replaces the registry's entities and components with a snapshot taken with
+     * the same component types in the same order. Pools of other types are
+     * emptied, groups are rebuilt, recorded changes are dropped and no
+     * callbacks are called.
+     *
+     * Returns false if the data doesn't hold a matching snapshot. If the header
+     * or entity array is bad the registry is untouched, if the components are
+     * the registry is left with no entities.
+     */
+    template <typename... Types>
+    bool restore(std::span<const std::byte> data)
+    {
+        internal::buffer_reader reader{ data };
+        return read_snapshot<Types...>(reader);
+    }
+
+    template <typename... Types>
+    bool restore(std::istream& stream)
+    {
+        internal::stream_reader reader{ stream };
+        return read_snapshot<Types...>(reader);
+    }
+
+    /**
+     * This is a mapping function that accepts a lambda or function and component types.
+     * It functions as creating a view with the passed in types and running the passed function
+     * on that view on each match. The function arguments should be entity_id and then following that
+     * references to each passed component type.
+     *
+     * This function could do with some better type-checking as when an invalid function is passed
+     * it just spits out a bunch of template garbage.
+     */
+    template <typename... Types, typename Func>
+    void for_each(Func func)
+    {
+        ADK_ECS_INSTRUMENT(const auto start = std::chrono::steady_clock::now();)
+        auto this_view = new_view<Types...>(); 
+        this_view.each(func);
+        ADK_ECS_INSTRUMENT(record_query<Types...>(start, this_view.checked, this_view.rejected);)
+    }
+
+    /**
+     * Parallel version of for_each, matches are split into cache-sized chunks that
+     * are spread over the threads of pool. The function is called concurrently
+     * so it must not create or delete entities or change components other than
+     * the ones it is passed.
+     */
+    template <typename... Types, typename Func>
+    void par_for_each(thread_pool& pool, Func func)
+    {
+        new_par_view<Types...>().for_each(pool, func);
+    }
+
+    /**
+     * par_for_each using the shared default_thread_pool().
+     */
+    template <typename... Types, typename Func>
+    void par_for_each(Func func)
+    {
+        par_for_each<Types...>(default_thread_pool(), func);
+    }
+
+    /*
+     * Factory function for a view on this registry.
+     */
+    template <typename... Types>
+    view_t<Types...> new_view()
+    {
+        return view_t<Types...>(*this);
+    }
+
+    /**
+     * Applies the commands recorded in each buffer and clears them. Creates run
+     * first, in buffer order, then removes, then adds and finally destroys. Removes
+     * and adds are sorted by component type so each pool is touched in one run.
+     * Adding a component an entity already has replaces it, commands on entities
+     * that are no longer valid are dropped.
+     *
+     * Must be called while no other thread is using the registry or the buffers.
+     */
+    void playback(std::span<command_buffer<entity_id, max_components>> buffers)
+    {
+        flush_reserved();
+        command_buffer<entity_id, max_components>::playback(*this, buffers, memory.get());
+    }
+
+    void playback(command_buffer<entity_id, max_components>& buffer)
+    {
+        playback(std::span(&buffer, 1));
+    }
+
+    /**
+     * Creates an owning group over the passed types and returns a view of it. The
+     * group takes ownership of the pools and keeps entities that have all of the
+     * types packed at the front of each pool in the same order, assign, unassign
+     * and delete_entity keep it that way. Views and for_each calls over the same
+     * types (or a superset) then walk the pools in lockstep.
+     *
+     * A pool can only be owned by one group, calling this again with the
+     * same types just returns a new view.
+     */
+    template <typename... Types>
+    view<Types...> group()
+    {
+        static_assert(sizeof...(Types) > 0, "A group needs at least one component type");
+        static_assert(!internal::has_filters<Types...>, "A group can't own added or changed terms");
+        static_assert((std::is_same_v<internal::flat_terms<Types>, std::tuple<Types>> && ...), "A group only owns plain component types");
+        static_assert(!(std::is_const_v<Types> || ...), "A group only owns plain component types");
+        static_assert(!(internal::is_tag<Types> || ...), "Tags have no pool for a group to own");
+        static_assert(!(internal::split_component<Types> || ...), "Split components can't be grouped");
+        static_assert(!(std::is_same_v<Types, relationship_type> || ...), "The registry keeps the relationship pool sorted by depth");
+        const std::array<internal::i_component_allocator<entity_id>*, sizeof...(Types)> pools = {
+            component_manager.template assure<Types>()...
+        };
+        if (pools[0]->owner != nullptr) {
+            ADK_ASSERT(pools[0]->owner->pools.size() == pools.size());
+            ADK_ASSERT(std::equal(pools.begin(), pools.end(), pools[0]->owner->pools.begin()));
+            return new_view<Types...>();
+        }
+
+        auto handler = internal::make_resource_ptr<internal::group_handler<entity_id>>(memory.get(), memory.get());
+        handler->pools.assign(pools.begin(), pools.end());
+        for (const auto pool : pools) {
+            ADK_ASSERT(pool->owner == nullptr);
+            pool->owner = handler.get();
+        }
+        // Existing members are swapped towards the front, entities behind the current
+        // position have already been checked so the walk never misses one.
+        for (std::size_t i = 0; i < pools[0]->size(); i++) {
+            handler->on_construct(pools[0]->entities[i]);
+        }
+        groups.push_back(std::move(handler));
+        return new_view<Types...>();
+    }
+
+    /*
+     * Factory function for a parallel view on this registry.
+     */
+    template <typename... Types>
+    par_view_t<Types...> new_par_view()
+    {
+        return par_view_t<Types...>(*this);
+    }
+};
+
+/**
+ * Records structural changes to be applied to a registry later with
+ * registry::playback, so they can be queued during iteration or from worker
+ * threads. A buffer is not thread-safe, each thread should record into its own.
+ *
+ * Commands are kept in one linear byte stream, each one a fixed header
+ * followed by the component value for adds.
+ */
+template <typename entity_id = internal::DEFAULT_ENTITY_ID_TYPE, std::size_t max_components = internal::MAX_COMPONENTS>
+class command_buffer
+{
+public:
+    using registry_type = registry<entity_id, max_components>;
+
+    /**
+     * Handle to an entity created by this buffer, only usable with this buffer
+     * until it has been played back. It can be passed to add and destroy like
+     * an existing entity. There's no remove for it since removes play back
+     * before adds, when the new entity has no components yet.
+     */
+    struct pending_entity
+    {
+        std::size_t index;
+    };
+
+    command_buffer() = default;
+
+    command_buffer(command_buffer&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    command_buffer& operator=(command_buffer&& other) noexcept
+    {
+        if (this != &other) {
+            clear();
+            release();
+            data = std::exchange(other.data, nullptr);
+            used = std::exchange(other.used, 0);
+            capacity = std::exchange(other.capacity, 0);
+            count = std::exchange(other.count, 0);
+            create_count = std::exchange(other.create_count, 0);
+            created_ids = std::move(other.created_ids);
+        }
+        return *this;
+    }
+
+    command_buffer(const command_buffer&) = delete;
+    command_buffer& operator=(const command_buffer&) = delete;
+
+    ~command_buffer()
+    {
+        clear();
+        release();
+    }
+
+    pending_entity create()
+    {
+        push_header(command_type::create, 0, false, nullptr, 0, 1);
+        return { create_count++ };
+    }
+
+    void destroy(entity_id entity)
+    {
+        push_header(command_type::destroy, entity, false, nullptr, 0, 1);
+    }
+
+    void destroy(pending_entity entity)
+    {
+        ADK_ASSERT(entity.index < create_count);
+        push_header(command_type::destroy, static_cast<entity_id>(entity.index), true, nullptr, 0, 1);
+    }
+
+    template <typename T>
+    void add(entity_id entity, T component)
+    {
+        push_component(entity, false, std::move(component));
+    }
+
+    template <typename T>
+    void add(pending_entity entity, T component)
+    {
+        ADK_ASSERT(entity.index < create_count);
+        push_component(static_cast<entity_id>(entity.index), true, std::move(component));
+    }
+
+    template <typename T>
+    void remove(entity_id entity)
+    {
+        push_header(command_type::remove, entity, false, &ops_for<T>, 0, 1);
+    }
+
+    /**
+     * Returns number of recorded commands.
+     */
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    /**
+     * Returns number of bytes used by the recorded commands.
+     */
+    std::size_t bytes() const
+    {
+        return used;
+    }
+
+    /**
+     * Ids of the entities created by the last playback, indexed by pending_entity::index.
+     */
+    std::span<const entity_id> created() const
+    {
+        return created_ids;
+    }
+
+    /**
+     * Drops every recorded command, keeping the memory for reuse.
+     */
+    void clear()
+    {
+        for_each_header([](header* command) {
+            if (command->payload != 0 && command->ops->destroy != nullptr) {
+                command->ops->destroy(payload_of(command));
+            }
+        });
+        used = 0;
+        count = 0;
+        create_count = 0;
+    }
+
+private:
+    friend registry_type;
+
+    enum class command_type : std::uint8_t
+    {
+        create,
+        remove,
+        add,
+        destroy,
+    };
+
+    /**
+     * Type-erased operations for a component type.
+     */
+    struct component_ops
+    {
+        std::size_t (*component_id)();
+        // Null when the type is trivially copyable
+        void (*relocate)(void* destination, void* source);
+        void (*destroy)(void* payload);
+        void (*add)(registry_type& reg, entity_id entity, void* payload);
+        void (*remove)(registry_type& reg, entity_id entity);
+    };
+
+    struct header
+    {
+        command_type type;
+        bool pending;
+        std::uint32_t size;
+        std::uint32_t payload;
+        entity_id entity;
+        const component_ops* ops;
+    };
+
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    template <typename T>
+    static constexpr component_ops ops_for = {
+        []() { return internal::get_component_id<T>(); },
+        std::is_trivially_copyable_v<T> ? nullptr : +[](void* destination, void* source) {
+            new (destination) T(std::move(*static_cast<T*>(source)));
+            static_cast<T*>(source)->~T();
+        },
+        std::is_trivially_destructible_v<T> ? nullptr : +[](void* payload) {
+            static_cast<T*>(payload)->~T();
+        },
+        [](registry_type& reg, entity_id entity, void* payload) {
+            auto& component = *static_cast<T*>(payload);
+            if (reg.template has<T>(entity)) {
+                reg.template patch<T>(entity, [&component](T& current) { current = std::move(component); });
+            } else {
+                reg.template assign<T>(entity, std::move(component));
+            }
+            component.~T();
+        },
+        [](registry_type& reg, entity_id entity) {
+            if (reg.template has<T>(entity)) {
+                reg.template unassign<T>(entity);
+            }
+        },
+    };
+
+    std::byte* data = nullptr;
+    std::size_t used = 0;
+    std::size_t capacity = 0;
+    std::size_t count = 0;
+    std::size_t create_count = 0;
+    std::vector<entity_id> created_ids;
+
+    static constexpr std::size_t align_up(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static void* payload_of(header* command)
+    {
+        return reinterpret_cast<std::byte*>(command) + command->payload;
+    }
+
+    template <typename Func>
+    void for_each_header(Func func)
+    {
+        for (std::size_t offset = 0; offset < used;) {
+            auto* command = reinterpret_cast<header*>(data + offset);
+            offset += command->size;
+            func(command);
+        }
+    }
+
+    /**
+     * Appends a header with room for a payload and returns it.
+     */
+    header* push_header(command_type type, entity_id entity, bool pending, const component_ops* ops,
+        std::size_t payload_size, std::size_t payload_alignment)
+    {
+        const std::size_t start = align_up(used, alignof(header));
+        const std::size_t payload = payload_size == 0 ? 0
+            : align_up(start + sizeof(header), payload_alignment) - start;
+        const std::size_t size = align_up(std::max(payload + payload_size, sizeof(header)), alignof(header));
+        reserve(start + size);
+
+        auto* command = new (data + start) header {
+            type, pending, static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(payload), entity, ops,
+        };
+        used = start + size;
+        count++;
+        return command;
+    }
+
+    template <typename T>
+    void push_component(entity_id entity, bool pending, T&& component)
+    {
+        using type = std::decay_t<T>;
+        static_assert(alignof(type) <= ALIGNMENT, "Component is too over-aligned for a command buffer");
+        static_assert(!std::is_same_v<type, relationship<entity_id>>, "Hierarchy links are added with set_parent");
+        auto* command = push_header(command_type::add, entity, pending, &ops_for<type>, sizeof(type), alignof(type));
+        new (payload_of(command)) type(std::forward<T>(component));
+    }
+
+    /**
+     * Grows the byte stream, relocating components that aren't trivially copyable.
+     */
+    void reserve(std::size_t size)
+    {
+        if (size <= capacity) {
+            return;
+        }
+        const std::size_t new_capacity = std::max(size, capacity == 0 ? std::size_t(1024) : capacity * 2);
+        auto* new_data = static_cast<std::byte*>(::operator new(new_capacity, std::align_val_t(ALIGNMENT)));
+        if (data != nullptr) {
+            std::memcpy(new_data, data, used);
+            for_each_header([this, new_data](header* command) {
+                if (command->payload != 0 && command->ops->relocate != nullptr) {
+                    const auto offset = reinterpret_cast<std::byte*>(command) - data;
+                    auto* moved = reinterpret_cast<header*>(new_data + offset);
+                    command->ops->relocate(payload_of(moved), payload_of(command));
+                }
+            });
+            release();
         }
+        data = new_data;
+        capacity = new_capacity;
+    }
 
-        view<Types...> end()
-        {
-            auto v = view<Types...>(reg);
-            v.current_index = reg.current_index;
-            return v;
+    void release()
+    {
+        if (data != nullptr) {
+            ::operator delete(data, std::align_val_t(ALIGNMENT));
+            data = nullptr;
+            capacity = 0;
         }
+    }
 
-    private:
-        registry<entity_id>& reg;
-        std::size_t current_index = -1;
-        std::size_t first_valid;
-        std::uint64_t mask = 0;
-        
-        template <typename T>
-        void add_type_to_mask()
-        {
-            const auto component_id = internal::get_component_id<T>();
-            mask |= (1 << component_id);
+    struct playback_entry
+    {
+        std::uint64_t key;
+        header* command;
+        std::size_t buffer;
+    };
+
+    /**
+     * Applies the buffers to the registry, scratch is the registry's own
+     * memory resource which the sorted command list is allocated from.
+     */
+    static void playback(registry_type& reg, std::span<command_buffer> buffers, std::pmr::memory_resource* scratch)
+    {
+        std::pmr::vector<playback_entry> entries(scratch);
+        std::size_t total = 0;
+        for (auto& buffer : buffers) {
+            total += buffer.count;
         }
+        entries.reserve(total);
 
-        void find_next_valid()
-        {
-            current_index++;
-            while (current_index < reg.current_index) {
-                if (mask == 0 || (reg.entities[current_index].mask & mask) == mask) {
+        // Creates go first so every other command can resolve pending entities
+        std::uint64_t sequence = 0;
+        for (std::size_t i = 0; i < buffers.size(); i++) {
+            auto& buffer = buffers[i];
+            buffer.created_ids.resize(buffer.create_count);
+            reg.create_n(std::span<entity_id>(buffer.created_ids));
+            buffer.for_each_header([&](header* command) {
+                if (command->type == command_type::create) {
                     return;
                 }
-                current_index++;
+                const std::uint64_t phase = static_cast<std::uint64_t>(command->type);
+                const std::uint64_t component = command->ops != nullptr ? command->ops->component_id() : 0;
+                entries.push_back({ (phase << 60) | (component << 40) | sequence++, command, i });
+            });
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.key < b.key;
+        });
+
+        for (const auto& entry : entries) {
+            auto* command = entry.command;
+            const auto entity = command->pending ? buffers[entry.buffer].created_ids[command->entity] : command->entity;
+            const bool alive = reg.valid(entity);
+            switch (command->type) {
+                case command_type::remove:
+                    if (alive) {
+                        command->ops->remove(reg, entity);
+                    }
+                    break;
+                case command_type::add:
+                    if (alive) {
+                        command->ops->add(reg, entity, payload_of(command));
+                    } else if (command->ops->destroy != nullptr) {
+                        command->ops->destroy(payload_of(command));
+                    }
+                    // Payload is consumed either way
+                    command->payload = 0;
+                    break;
+                case command_type::destroy:
+                    if (alive) {
+                        reg.delete_entity(entity);
+                    }
+                    break;
+                case command_type::create:
+                    break;
             }
         }
-    };
 
+        for (auto& buffer : buffers) {
+            buffer.clear();
+        }
+    }
+};
+
+/**
+ * Set of component values that registry::instantiate copies onto new entities,
+ * so spawning many entities of the same kind costs one signature write per
+ * entity and one batch per component pool. Components are set once when the
+ * prefab is built and can be changed between instantiations.
+ */
+template <typename entity_id = internal::DEFAULT_ENTITY_ID_TYPE, std::size_t max_components = internal::MAX_COMPONENTS>
+class prefab
+{
 public:
-    using entity_id_type = entity_id;
+    explicit prefab(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : entries(resource)
+    {}
+
+    prefab(prefab&& other) noexcept
+        : mask(std::exchange(other.mask, {})),
+          entries(std::move(other.entries))
+    {}
 
     /**
-     * Constructs new entity_id and handles populating deleted entities,
-     * as well as creating brand new ones.
+     * Both prefabs must use the same memory resource.
      */
-    entity_id new_entity()
+    prefab& operator=(prefab&& other) noexcept
     {
-        // If there's a deleted id, modify the version and use it instead
-        if (deleted_ids.size() > 0) {
-            const auto old_id = deleted_ids.front();
-            const auto version = internal::get_entity_version(old_id);
-            const auto index = internal::get_entity_index(old_id);
-            const auto new_id = internal::set_entity_version(old_id, version + 1);
-            ADK_ASSERT(entities.size() >= index);
-            ADK_ASSERT(!internal::entity_is_valid(entities[index].id));
-            entities[index].mask = 0;
-            entities[index].id = new_id;
-            return new_id;
-        }
-        
-        // Resize entity vector if there's too many.
-        if (current_index >= entities.size()) {
-            entities.resize(current_index == 0 ? 32 : current_index * 2);
+        if (this != &other) {
+            ADK_ASSERT(entries.get_allocator() == other.entries.get_allocator());
+            clear();
+            mask = std::exchange(other.mask, {});
+            entries = std::move(other.entries);
+            other.entries.clear();
         }
-        
-        entities[current_index].id = internal::set_entity_index<entity_id>(0, current_index);
-        return entities[current_index++].id;
+        return *this;
     }
-    
+
+    prefab(const prefab&) = delete;
+    prefab& operator=(const prefab&) = delete;
+
+    ~prefab()
+    {
+        clear();
+    }
+
     /**
-     * Queues entity in deletion queue and invalidates it.
+     * Adds the component to the prefab, replacing the value it had if any.
      */
-    void delete_entity(entity_id entity)
+    template <typename T>
+    prefab& set(T component)
     {
-        const auto index = internal::get_entity_index(entity);
-        ADK_ASSERT(entities.size() >= index);
-        entities[index] = { .id = internal::create_invalid_entity<entity_id>() };
-        deleted_ids.push(entity);
-        component_manager.entity_destroyed(entity);
+        static_assert(!std::is_same_v<T, relationship<entity_id>>, "Hierarchy links can't be part of a prefab");
+        const auto component_id = internal::signature<max_components>::component_bit(internal::get_component_id<T>());
+        if (const auto value = find(component_id)) {
+            *static_cast<T*>(value) = std::move(component);
+            return *this;
+        }
+        const auto resource = entries.get_allocator().resource();
+        void* value = resource->allocate(sizeof(T), alignof(T));
+        new (value) T(std::move(component));
+        entries.push_back({ component_id, &ops_for<T>, value });
+        mask.set(component_id);
+        return *this;
     }
-    
+
+    template <typename T>
+    bool has() const
+    {
+        return mask.test(internal::signature<max_components>::component_bit(internal::get_component_id<T>()));
+    }
+
+    template <typename T>
+    T& get()
+    {
+        const auto value = find(internal::get_component_id<T>());
+        ADK_ASSERT(value != nullptr);
+        return *static_cast<T*>(value);
+    }
+
     /**
-     * Returns whether or not the entity has the component of type T.
-     * T must be a valid component type as passing it here will affect
-     * a global component state.
+     * Destroys every component of the prefab.
      */
+    void clear()
+    {
+        const auto resource = entries.get_allocator().resource();
+        for (const auto& entry : entries) {
+            entry.ops->destroy(resource, entry.value);
+        }
+        entries.clear();
+        mask = {};
+    }
+
+private:
+    friend registry<entity_id, max_components>;
+
+    struct component_ops
+    {
+        // Copies the value into the pool of every passed entity, null for tags
+        void (*insert_n)(internal::component_manager<entity_id>&, std::span<const entity_id>, const void*);
+        void (*destroy)(std::pmr::memory_resource*, void*);
+    };
+
+    struct entry
+    {
+        std::size_t component_id;
+        const component_ops* ops;
+        void* value;
+    };
+
     template <typename T>
-    bool has(entity_id entity)
+    static constexpr component_ops ops_for = {
+        internal::is_tag<T> ? nullptr : +[](internal::component_manager<entity_id>& manager, std::span<const entity_id> entities, const void* value) {
+            if constexpr (!internal::is_tag<T>) {
+                manager.template assure<T>()->insert_n(entities, *static_cast<const T*>(value));
+            }
+        },
+        [](std::pmr::memory_resource* resource, void* value) {
+            static_cast<T*>(value)->~T();
+            resource->deallocate(value, sizeof(T), alignof(T));
+        },
+    };
+
+    internal::signature<max_components> mask;
+    std::pmr::vector<entry> entries;
+
+    void* find(std::size_t component_id) const
     {
-        const auto component_id = internal::get_component_id<T>();
-        const auto& internal_entity = entities[internal::get_entity_index(entity)];
-        return (internal_entity.mask & (1 << component_id)) != 0;
+        for (const auto& entry : entries) {
+            if (entry.component_id == component_id) {
+                return entry.value;
+            }
+        }
+        return nullptr;
     }
-    
+};
+
+/**
+ * Double-buffered copy of a registry's pools of Types, so other threads can read
+ * one frame while the registry is already being changed for the next. extract
+ * copies the pools into the buffer that isn't the latest and publishes it. A
+ * pool that hasn't been written since that buffer last copied it is skipped,
+ * and the buffers keep their memory from one extraction to the next.
+ *
+ * Pools count as written when they change shape, when patch or non-const get
+ * is called on them and when a view hands out mutable references to their
+ * components, whether or not those were actually modified. get<const T>, get
+ * on a const registry, const T view terms and the reads of scheduler systems
+ * don't count. Only the moment a reference is handed out is recorded, writes
+ * through a T& kept from an earlier frame go unnoticed and the pool may then
+ * be skipped.
+ *
+ * extract must be called while nothing else uses the registry, usually at the
+ * end of a frame. A published frame is overwritten by the second extract after
+ * it, readers must be done with it by then.
+ */
+template <typename Registry, typename... Types>
+class extract_buffer
+{
+public:
+    using entity_id = typename Registry::entity_id_type;
+
     /**
-     * Adds a component to passed entity and returns a reference to the 
-     * registry-owned version of it.
+     * Read-only copy of the pools at the time they were extracted. Components are
+     * in the order of their pool, entities<T>()[i] owns components<T>()[i].
      */
-    template <typename T>
-    T& assign(entity_id entity, const T&& component)
+    class frame
     {
-        ADK_ASSERT(!has<T>(entity));
-        const auto component_id = internal::get_component_id<T>();
-        auto& internal_entity = entities[internal::get_entity_index(entity)];
-        internal_entity.mask |= (1 << component_id);
-        return component_manager.insert(entity, std::move(component));
+        template <typename T>
+        struct pool_copy
+        {
+            std::pmr::vector<entity_id> entities;
+            std::pmr::vector<T> components;
+            // Write version of the pool when it was copied
+            std::uint64_t version = 0;
+            bool copied = false;
+
+            explicit pool_copy(std::pmr::memory_resource* resource)
+                : entities(resource),
+                  components(resource)
+            {}
+        };
+
+    public:
+        explicit frame(std::pmr::memory_resource* resource)
+            : pools(pool_copy<Types>(resource)...)
+        {}
+
+        template <typename T>
+        std::span<const entity_id> entities() const
+        {
+            return std::get<pool_copy<T>>(pools).entities;
+        }
+
+        template <typename T>
+        std::span<const T> components() const
+        {
+            return std::get<pool_copy<T>>(pools).components;
+        }
+
+        /**
+         * Calls func with every entity in the copy of T's pool and its component.
+         */
+        template <typename T, typename Func>
+        void for_each(Func func) const
+        {
+            const auto& copy = std::get<pool_copy<T>>(pools);
+            for (std::size_t i = 0; i < copy.entities.size(); i++) {
+                func(copy.entities[i], copy.components[i]);
+            }
+        }
+
+        /**
+         * Returns which extraction produced the frame, counting from 1.
+         */
+        std::uint64_t number() const
+        {
+            return extraction;
+        }
+
+    private:
+        friend extract_buffer;
+
+        std::tuple<pool_copy<Types>...> pools;
+        std::uint64_t extraction = 0;
+    };
+
+    explicit extract_buffer(Registry& reg, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : reg(reg),
+          frames{ frame(resource), frame(resource) }
+    {}
+
+    extract_buffer(const extract_buffer&) = delete;
+    extract_buffer& operator=(const extract_buffer&) = delete;
+
+    /**
+     * Copies the pools that changed into the older frame, publishes it and
+     * returns it.
+     */
+    const frame& extract()
+    {
+        const int back = published.load(std::memory_order_relaxed) == 0 ? 1 : 0;
+        auto& target = frames[back];
+        copied = 0;
+        (copy_pool<Types>(target), ...);
+        target.extraction = ++extractions;
+        published.store(back, std::memory_order_release);
+        return target;
     }
-    
+
     /**
-     * Removes a component from an entity.
+     * Returns the frame published by the last extract, or null if there hasn't
+     * been one. Can be called from any thread.
      */
-    template <typename T>
-    void unassign(entity_id entity)
+    const frame* latest() const
     {
-        ADK_ASSERT(has<T>(entity));
-        const auto component_id = internal::get_component_id<T>();
-        auto& internal_entity = entities[internal::get_entity_index(entity)];
-        internal_entity.mask &= ~(1 << component_id);
-        component_manager.destroy(entity);
+        const int index = published.load(std::memory_order_acquire);
+        return index < 0 ? nullptr : &frames[index];
     }
-    
+
     /**
-     * Returns a reference to registry-owned component held by passed entity.
-     * Expects that entity does contain component.
+     * Returns number of pools the last extract copied, the rest were unchanged.
      */
+    std::size_t copied_pools() const
+    {
+        return copied;
+    }
+
+private:
+    Registry& reg;
+    std::array<frame, 2> frames;
+    std::atomic<int> published = -1;
+    std::uint64_t extractions = 0;
+    std::size_t copied = 0;
+
     template <typename T>
-    T& get(entity_id entity)
+    void copy_pool(frame& target)
     {
-        ADK_ASSERT(has<T>(entity));
-        return component_manager.template get<T>(entity);
+        static_assert(!internal::is_tag<T>, "Tags have no pool to copy");
+        static_assert(!internal::split_component<T>, "Split components can't be extracted");
+        auto& copy = std::get<typename frame::template pool_copy<T>>(target.pools);
+        const auto pool = reg.component_manager.template find<T>();
+        if (pool == nullptr) {
+            copy.entities.clear();
+            copy.components.clear();
+            copy.copied = false;
+            return;
+        }
+        const auto version = pool->consume_writes();
+        if (copy.copied && copy.version == version) {
+            return;
+        }
+        copy.entities.assign(pool->entities.begin(), pool->entities.end());
+        if constexpr (std::is_same_v<internal::component_storage<T>, std::pmr::vector<T>>) {
+            copy.components.assign(pool->arr.begin(), pool->arr.end());
+        } else {
+            copy.components.clear();
+            copy.components.reserve(pool->size());
+            for (std::size_t i = 0; i < pool->size(); i++) {
+                copy.components.push_back(pool->arr[i]);
+            }
+        }
+        copy.version = version;
+        copy.copied = true;
+        copied++;
     }
-    
+};
+
+/**
+ * Component types a system only reads.
+ */
+template <typename... Types>
+struct reads {};
+
+/**
+ * Component types a system reads and writes.
+ */
+template <typename... Types>
+struct writes {};
+
+/**
+ * Declares the component access of a system, ex. system<reads<Position>, writes<Velocity>>.
+ * Used by the scheduler to decide which systems can run at the same time.
+ */
+template <typename Reads = reads<>, typename Writes = writes<>>
+struct system;
+
+template <typename... Reads, typename... Writes>
+struct system<reads<Reads...>, writes<Writes...>>
+{
+    using read_types = std::tuple<Reads...>;
+    using write_types = std::tuple<Writes...>;
+
+    static_assert(!internal::types_intersect<read_types, write_types>::value,
+        "A component type should be listed in either reads or writes, not both");
+};
+
+/**
+ * Whether or not two systems can't run at the same time, which is the case when
+ * one of them writes a component type the other reads or writes.
+ */
+template <typename A, typename B>
+constexpr bool systems_conflict =
+    internal::types_intersect<typename A::write_types, typename B::write_types>::value
+    || internal::types_intersect<typename A::write_types, typename B::read_types>::value
+    || internal::types_intersect<typename A::read_types, typename B::write_types>::value;
+
+/**
+ * Runs systems on a thread pool, each system declares the components it reads and
+ * writes and systems that don't conflict run concurrently. Systems that conflict
+ * run in the order they were added.
+ *
+ * A system function either takes the registry, in which case it should only touch
+ * the components it declared, or is called for each entity with all of its
+ * declared components as entity_id, const Reads&..., Writes&...
+ */
+template <typename entity_id = internal::DEFAULT_ENTITY_ID_TYPE, std::size_t max_components = internal::MAX_COMPONENTS>
+class scheduler
+{
+public:
+    using registry_type = registry<entity_id, max_components>;
+
+    scheduler(registry_type& reg, thread_pool& pool = default_thread_pool())
+        : reg(reg), pool(pool)
+    {}
+
     /**
-     * This is a mapping function that accepts a lambda or function and component types.
-     * It functions as creating a view with the passed in types and running the passed function
-     * on that view on each match. The function arguments should be entity_id and then following that
-     * references to each passed component type.
-     *
-     * This function could do with some better type-checking as when an invalid function is passed
-     * it just spits out a bunch of template garbage.
+     * Adds a system to the end of the frame, System should be an adk::ecs::system.
+     * The name is only used to label the system in stats().
      */
-    template <typename... Types, typename Func>
-    void for_each(Func func)
+    template <typename System, typename Func>
+    void add(Func func, std::string_view name = {})
     {
-        auto this_view = new_view<Types...>(); 
-        for (const auto& tuple : this_view) {
-            std::apply(func, tuple);
+        add_system(func, static_cast<typename System::read_types*>(nullptr),
+            static_cast<typename System::write_types*>(nullptr));
+        systems.back().stats.name = name;
+    }
+
+    /**
+     * Runs every system once and returns when all of them are done. If a system
+     * throws, systems that haven't started yet are skipped and the first
+     * exception is rethrown once every system is accounted for.
+     */
+    void run()
+    {
+        if (systems.empty()) {
+            return;
+        }
+        build_graph();
+
+        frame_state state = { this, systems.size(), {} };
+        state.pending = std::make_unique<std::atomic<std::size_t>[]>(systems.size());
+        for (std::size_t i = 0; i < systems.size(); i++) {
+            state.pending[i].store(systems[i].dependency_count, std::memory_order_relaxed);
         }
+        for (std::size_t i = 0; i < systems.size(); i++) {
+            if (systems[i].dependency_count == 0) {
+                pool.push({ run_system, &state, i, i + 1 });
+            }
+        }
+        pool.wait(state.remaining);
+#ifdef ADK_ECS_EXCEPTIONS
+        if (state.error) {
+            std::rethrow_exception(state.error);
+        }
+#endif
     }
 
-    /*
-     * Factory function for a view on this registry.
+    std::size_t size() const
+    {
+        return systems.size();
+    }
+
+    /**
+     * Returns the name and run times of every system in the order they were
+     * added, times are only recorded with ADK_ECS_INSTRUMENTATION.
      */
-    template <typename... Types>
-    view<Types...> new_view()
+    std::vector<system_stats> stats() const
+    {
+        std::vector<system_stats> result;
+        for (const auto& system : systems) {
+            result.push_back(system.stats);
+        }
+        return result;
+    }
+
+private:
+    struct system_entry
+    {
+        std::vector<std::size_t> reads;
+        std::vector<std::size_t> writes;
+        std::function<void(registry_type&)> func;
+        std::vector<std::size_t> dependents;
+        std::size_t dependency_count = 0;
+        system_stats stats;
+    };
+
+    struct frame_state
+    {
+        scheduler* self;
+        std::atomic<std::size_t> remaining;
+        std::unique_ptr<std::atomic<std::size_t>[]> pending;
+#ifdef ADK_ECS_EXCEPTIONS
+        std::atomic<bool> failed = false;
+        std::exception_ptr error = nullptr;
+#endif
+    };
+
+    registry_type& reg;
+    thread_pool& pool;
+    std::vector<system_entry> systems;
+    bool graph_dirty = false;
+
+    template <typename Func, typename... Reads, typename... Writes>
+    void add_system(Func func, std::tuple<Reads...>*, std::tuple<Writes...>*)
     {
-        return view<Types...>(*this);
+        system_entry entry;
+        entry.reads = { internal::get_component_id<Reads>()... };
+        entry.writes = { internal::get_component_id<Writes>()... };
+        if constexpr (std::is_invocable_v<Func&, registry_type&>) {
+            entry.func = std::move(func);
+        } else {
+            entry.func = [func](registry_type& reg) {
+                reg.template for_each<const Reads..., Writes...>(func);
+            };
+        }
+        systems.push_back(std::move(entry));
+        graph_dirty = true;
+    }
+
+    static bool ids_intersect(const std::vector<std::size_t>& a, const std::vector<std::size_t>& b)
+    {
+        for (const auto id : a) {
+            if (std::find(b.begin(), b.end(), id) != b.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool conflict(const system_entry& a, const system_entry& b)
+    {
+        return ids_intersect(a.writes, b.writes) || ids_intersect(a.writes, b.reads)
+            || ids_intersect(a.reads, b.writes);
+    }
+
+    /**
+     * Makes each system depend on every earlier system it conflicts with.
+     * Only redone when systems were added since the last frame.
+     */
+    void build_graph()
+    {
+        if (!graph_dirty) {
+            return;
+        }
+        for (auto& system : systems) {
+            system.dependents.clear();
+            system.dependency_count = 0;
+        }
+        for (std::size_t i = 0; i < systems.size(); i++) {
+            for (std::size_t j = 0; j < i; j++) {
+                if (conflict(systems[i], systems[j])) {
+                    systems[j].dependents.push_back(i);
+                    systems[i].dependency_count++;
+                }
+            }
+        }
+        graph_dirty = false;
+    }
+
+    static void time_system(scheduler* self, std::size_t index)
+    {
+        ADK_ECS_INSTRUMENT(const auto start = std::chrono::steady_clock::now();)
+        self->systems[index].func(self->reg);
+        ADK_ECS_INSTRUMENT(
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            self->systems[index].stats.timing.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        )
+    }
+
+    static void run_system(void* context, std::size_t index, std::size_t)
+    {
+        auto* state = static_cast<frame_state*>(context);
+        auto* self = state->self;
+#ifdef ADK_ECS_EXCEPTIONS
+        // Dependents are still released after a failure so remaining reaches
+        // zero and run() can rethrow once nothing refers to the frame
+        if (!state->failed.load(std::memory_order_relaxed)) {
+            try {
+                time_system(self, index);
+            } catch (...) {
+                if (!state->failed.exchange(true, std::memory_order_relaxed)) {
+                    state->error = std::current_exception();
+                }
+            }
+        }
+#else
+        time_system(self, index);
+#endif
+        for (const auto dependent : self->systems[index].dependents) {
+            if (state->pending[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                self->pool.push({ run_system, state, dependent, dependent + 1 });
+            }
+        }
+        state->remaining.fetch_sub(1, std::memory_order_release);
     }
 };
 
 } // namespace adk::ecs
 
 #undef ADK_ASSERT
+#undef ADK_ECS_INSTRUMENT
+#undef ADK_ECS_AVX2
+#undef ADK_ECS_SSE2
+#undef ADK_ECS_EXCEPTIONS
 
 #endif
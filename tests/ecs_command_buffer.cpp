@@ -0,0 +1,143 @@
+#include "test.hpp"
+
+#include <memory>
+#include <string>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct label
+{
+    std::string text;
+};
+
+} // namespace
+
+ADK_TEST(command_buffer_creates_with_components)
+{
+    registry reg;
+    command_buffer buffer;
+    const auto first = buffer.create();
+    const auto second = buffer.create();
+    buffer.add(first, position{ 1.0f, 2.0f });
+    buffer.add(second, label{ "second" });
+    ADK_CHECK(buffer.size() == 4);
+    ADK_CHECK(buffer.bytes() > 0);
+
+    reg.playback(buffer);
+    ADK_CHECK(buffer.empty());
+    const auto created = buffer.created();
+    ADK_CHECK(created.size() == 2);
+    ADK_CHECK(reg.valid(created[0]) && reg.valid(created[1]));
+    ADK_CHECK(reg.get<position>(created[0]).y == 2.0f);
+    ADK_CHECK(reg.get<label>(created[1]).text == "second");
+    ADK_CHECK(!reg.has<label>(created[0]));
+}
+
+ADK_TEST(command_buffer_changes_pending_entities)
+{
+    registry reg;
+    const auto existing = reg.new_entity();
+    command_buffer buffer;
+    const auto kept = buffer.create();
+    const auto dropped = buffer.create();
+    buffer.add(kept, position{ 1.0f, 2.0f });
+    buffer.add(dropped, label{ "dropped" });
+    buffer.destroy(dropped);
+
+    reg.playback(buffer);
+    const auto created = buffer.created();
+    ADK_CHECK(reg.valid(created[0]) && !reg.valid(created[1]));
+    ADK_CHECK(reg.get<position>(created[0]).y == 2.0f);
+    // Pending indexes aren't mistaken for the existing entity of the same id
+    ADK_CHECK(reg.valid(existing) && reg.stats().live_entities == 2);
+}
+
+ADK_TEST(command_buffer_playback_order)
+{
+    registry reg;
+    const auto e = reg.new_entity();
+    reg.assign<health>(e, health{ 1 });
+
+    // Recorded in the opposite order, played back as removes, adds, destroys
+    command_buffer buffer;
+    buffer.add(e, health{ 2 });
+    buffer.remove<health>(e);
+    reg.playback(buffer);
+    ADK_CHECK(reg.has<health>(e) && reg.get<health>(e).value == 2);
+
+    // Adding a component the entity has replaces it
+    buffer.add(e, health{ 3 });
+    reg.playback(buffer);
+    ADK_CHECK(reg.get<health>(e).value == 3);
+
+    // Destroys run last, so the add before it is applied and then dropped with the entity
+    buffer.destroy(e);
+    buffer.add(e, label{ "gone" });
+    reg.playback(buffer);
+    ADK_CHECK(!reg.valid(e));
+}
+
+ADK_TEST(command_buffer_drops_commands_on_dead_entities)
+{
+    registry reg;
+    const auto e = reg.new_entity();
+    reg.delete_entity(e);
+    auto owner = std::make_shared<int>(0);
+    command_buffer buffer;
+    buffer.add(e, owner);
+    buffer.remove<health>(e);
+    buffer.destroy(e);
+    ADK_CHECK(owner.use_count() == 2);
+    reg.playback(buffer);
+    // The payload was destroyed without being added
+    ADK_CHECK(owner.use_count() == 1);
+    ADK_CHECK(!reg.valid(e));
+}
+
+ADK_TEST(command_buffer_relocates_payloads_when_growing)
+{
+    registry reg;
+    command_buffer buffer;
+    std::vector<command_buffer::pending_entity> pending;
+    for (int i = 0; i < 500; i++) {
+        pending.push_back(buffer.create());
+        buffer.add(pending.back(), label{ std::string(40, char('a' + i % 26)) });
+    }
+    reg.playback(buffer);
+    bool correct = true;
+    for (int i = 0; i < 500; i++) {
+        correct = correct && reg.get<label>(buffer.created()[i]).text == std::string(40, char('a' + i % 26));
+    }
+    ADK_CHECK(correct);
+}
+
+ADK_TEST(command_buffer_plays_back_several_buffers)
+{
+    registry reg;
+    std::vector<command_buffer> buffers(3);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j <= i; j++) {
+            buffers[i].add(buffers[i].create(), health{ i });
+        }
+    }
+    reg.playback(buffers);
+    std::size_t count = 0;
+    int total = 0;
+    reg.for_each<health>([&](entity, health& h) {
+        count++;
+        total += h.value;
+    });
+    ADK_CHECK(count == 6);
+    ADK_CHECK(total == 0 + 1 * 2 + 2 * 3);
+    ADK_CHECK(buffers[2].created().size() == 3);
+
+    // Cleared buffers can be recorded into again
+    const auto doomed = buffers[0].created()[0];
+    buffers[0].destroy(doomed);
+    reg.playback(buffers);
+    ADK_CHECK(!reg.valid(doomed));
+    ADK_CHECK(buffers[0].created().empty());
+}
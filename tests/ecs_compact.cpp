@@ -0,0 +1,118 @@
+#include "test.hpp"
+
+#include <chrono>
+
+using namespace adk::test;
+
+ADK_TEST(compact_trims_entities_and_pools)
+{
+    registry reg;
+    const auto ids = reg.create_n(1000, position{}, health{});
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        reg.get<health>(ids[i]).value = int(i);
+    }
+    // Everything past 100 goes, plus a few holes below it
+    reg.destroy_range(std::span(ids).subspan(100));
+    reg.delete_entity(ids[50]);
+    reg.delete_entity(ids[7]);
+    reg.delete_entity(ids[30]);
+    const auto before = reg.memory_usage().bytes_in_use;
+
+    ADK_CHECK(reg.compact());
+    const auto stats = reg.stats();
+    ADK_CHECK(stats.entity_slots == 100);
+    ADK_CHECK(stats.free_slots == 3 && stats.live_entities == 97);
+    ADK_CHECK(reg.memory_usage().bytes_in_use < before);
+    for (const auto& pool : stats.pools) {
+        ADK_CHECK(pool.size == 97 && pool.capacity == 97);
+    }
+
+    // Ids don't change
+    bool intact = true;
+    for (std::size_t i = 0; i < 100; i++) {
+        const bool deleted = i == 7 || i == 30 || i == 50;
+        intact = intact && reg.valid(ids[i]) != deleted;
+        intact = intact && (deleted || reg.get<health>(ids[i]).value == int(i));
+    }
+    ADK_CHECK(intact);
+
+    // The free list is rebuilt lowest index first, with new versions
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    const auto c = reg.new_entity();
+    ADK_CHECK(adk::ecs::internal::get_entity_index(a) == 7);
+    ADK_CHECK(adk::ecs::internal::get_entity_index(b) == 30);
+    ADK_CHECK(adk::ecs::internal::get_entity_index(c) == 50);
+    ADK_CHECK(a != ids[7] && !reg.valid(ids[7]));
+    ADK_CHECK(!reg.valid(ids[100]));
+    const auto d = reg.new_entity();
+    ADK_CHECK(adk::ecs::internal::get_entity_index(d) == 100);
+    ADK_CHECK(d != ids[100] && !reg.valid(ids[100]));
+}
+
+ADK_TEST(compact_in_steps)
+{
+    registry reg;
+    const auto ids = reg.create_n(500, position{}, velocity{});
+    reg.destroy_range(std::span(ids).subspan(10));
+
+    // With no budget every call does one step, the entities come first
+    ADK_CHECK(!reg.compact(std::chrono::nanoseconds(0)));
+    ADK_CHECK(reg.stats().entity_slots == 10);
+    for (const auto& pool : reg.stats().pools) {
+        ADK_CHECK(pool.capacity >= 500);
+    }
+    std::size_t calls = 1;
+    while (!reg.compact(std::chrono::nanoseconds(0))) {
+        calls++;
+    }
+    // Shrinking the pools takes more calls
+    ADK_CHECK(calls >= 2);
+    for (const auto& pool : reg.stats().pools) {
+        ADK_CHECK(pool.capacity == 10);
+    }
+    // The next call starts over
+    ADK_CHECK(!reg.compact(std::chrono::nanoseconds(0)));
+    ADK_CHECK(reg.compact());
+}
+
+ADK_TEST(compact_keeps_reservations_and_hierarchy)
+{
+    registry reg;
+    const auto ids = reg.create_n(20, position{});
+    reg.set_parent(ids[1], ids[0]);
+    reg.set_parent(ids[2], ids[1]);
+    const auto reserved = reg.reserve_entity();
+    reg.destroy_range(std::span(ids).subspan(3));
+
+    // Pending reservations are flushed first, so their slot isn't trimmed
+    reg.compact();
+    ADK_CHECK(reg.valid(reserved));
+    ADK_CHECK(reg.stats().entity_slots == 21);
+    ADK_CHECK(reg.hierarchy_depth() == 3 && reg.parent_of(ids[2]) == ids[1]);
+    reg.set_parent(ids[2], ids[0]);
+    ADK_CHECK(reg.hierarchy_depth() == 2);
+}
+
+ADK_TEST(compact_keeps_trimmed_ids_invalid)
+{
+    registry reg;
+    reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.delete_entity(b);
+    ADK_CHECK(reg.compact());
+    ADK_CHECK(reg.stats().entity_slots == 1);
+    const auto c = reg.new_entity();
+    ADK_CHECK(c != b && !reg.valid(b));
+
+    // Trimmed again, reserved and created in bulk
+    reg.delete_entity(c);
+    ADK_CHECK(reg.compact());
+    const auto d = reg.reserve_entity();
+    reg.flush_reserved();
+    ADK_CHECK(d != b && d != c && reg.valid(d) && !reg.valid(b) && !reg.valid(c));
+    reg.delete_entity(d);
+    ADK_CHECK(reg.compact());
+    const auto ids = reg.create_n(3, position{});
+    ADK_CHECK(ids[0] != b && ids[0] != c && ids[0] != d && !reg.valid(d));
+}
@@ -0,0 +1,112 @@
+#include "test.hpp"
+
+#include <algorithm>
+
+using namespace adk::test;
+
+namespace
+{
+
+entity index_of(entity e)
+{
+    return adk::ecs::internal::get_entity_index(e);
+}
+
+entity version_of(entity e)
+{
+    return adk::ecs::internal::get_entity_version(e);
+}
+
+} // namespace
+
+ADK_TEST(entities_recycle_freed_slots)
+{
+    registry reg;
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.delete_entity(a);
+    ADK_CHECK(!reg.valid(a));
+    ADK_CHECK(reg.stats().free_slots == 1);
+
+    // The freed slot is reused with a new version, the old id stays invalid
+    const auto c = reg.new_entity();
+    ADK_CHECK(index_of(c) == index_of(a));
+    ADK_CHECK(version_of(c) == version_of(a) + 1);
+    ADK_CHECK(reg.valid(c) && !reg.valid(a) && reg.valid(b));
+    ADK_CHECK(reg.stats().free_slots == 0);
+    ADK_CHECK(reg.stats().entity_slots == 2);
+
+    // A recycled entity starts without components
+    reg.assign<health>(b, health{ 1 });
+    reg.delete_entity(b);
+    const auto d = reg.new_entity();
+    ADK_CHECK(index_of(d) == index_of(b));
+    ADK_CHECK(!reg.has<health>(d));
+}
+
+ADK_TEST(entities_free_list_is_last_in_first_out)
+{
+    registry reg;
+    const auto ids = reg.create_n(5);
+    reg.delete_entity(ids[1]);
+    reg.delete_entity(ids[3]);
+    ADK_CHECK(index_of(reg.new_entity()) == index_of(ids[3]));
+    ADK_CHECK(index_of(reg.new_entity()) == index_of(ids[1]));
+    ADK_CHECK(index_of(reg.new_entity()) == 5);
+}
+
+ADK_TEST(entities_create_n_with_components)
+{
+    registry reg;
+    const auto ids = reg.create_n(1000, position{ 1.0f, 2.0f }, frozen{});
+    ADK_CHECK(ids.size() == 1000);
+    bool correct = true;
+    for (const auto e : ids) {
+        correct = correct && reg.valid(e) && reg.has<frozen>(e) && reg.get<position>(e).y == 2.0f;
+    }
+    ADK_CHECK(correct);
+
+    // Freed slots are used before new ones
+    reg.destroy_range(std::span(ids).subspan(0, 10));
+    const auto more = reg.create_n(20, health{ 3 });
+    ADK_CHECK(reg.stats().entity_slots == 1010);
+    ADK_CHECK(std::count_if(more.begin(), more.end(), [](entity e) { return index_of(e) < 10; }) == 10);
+}
+
+ADK_TEST(entities_destroy_range)
+{
+    registry reg;
+    const auto ids = reg.create_n(100, position{}, velocity{});
+    for (std::size_t i = 0; i < ids.size(); i += 2) {
+        reg.assign<health>(ids[i], health{});
+    }
+    reg.destroy_range(std::span(ids).subspan(0, 50));
+    bool correct = true;
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        correct = correct && reg.valid(ids[i]) == (i >= 50);
+    }
+    ADK_CHECK(correct);
+    std::size_t count = 0;
+    reg.for_each<position, velocity>([&](entity, position&, velocity&) { count++; });
+    ADK_CHECK(count == 50);
+    count = 0;
+    reg.for_each<health>([&](entity, health&) { count++; });
+    ADK_CHECK(count == 25);
+    ADK_CHECK(reg.stats().live_entities == 50);
+    ADK_CHECK(reg.stats().free_slots == 50);
+}
+
+ADK_TEST(entities_version_wraps)
+{
+    registry reg;
+    const auto first = reg.new_entity();
+    auto e = first;
+    // 16 bit versions wrap after 65536 deletions, the slot stays usable
+    for (int i = 0; i < 65537; i++) {
+        reg.delete_entity(e);
+        e = reg.new_entity();
+        ADK_CHECK(index_of(e) == index_of(first));
+    }
+    ADK_CHECK(reg.valid(e));
+    ADK_CHECK(reg.stats().entity_slots == 1);
+}
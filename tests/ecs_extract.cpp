@@ -0,0 +1,135 @@
+#include "test.hpp"
+
+#include <adk/adk_reflect.hpp>
+
+using namespace adk::test;
+
+namespace
+{
+
+using extract_buffer = adk::ecs::extract_buffer<registry, position, velocity>;
+
+struct sample
+{
+    float value = 0.0f;
+};
+
+} // namespace
+
+ADK_REFLECT_CLASS(sample, value)
+
+template <>
+struct adk::ecs::component_traits<sample>
+{
+    static constexpr bool split_members = true;
+};
+
+namespace
+{
+
+// Extracts into both frames so that each of them holds a copy of every pool
+void settle(extract_buffer& buffer)
+{
+    buffer.extract();
+    buffer.extract();
+}
+
+} // namespace
+
+ADK_TEST(extract_copies_pools)
+{
+    registry reg;
+    const auto ids = reg.create_n(10, position{ 1.0f, 0.0f }, velocity{ 2.0f, 0.0f });
+    extract_buffer buffer(reg);
+    ADK_CHECK(buffer.latest() == nullptr);
+
+    const auto& frame = buffer.extract();
+    ADK_CHECK(buffer.latest() == &frame && frame.number() == 1);
+    ADK_CHECK(buffer.copied_pools() == 2);
+    ADK_CHECK(frame.entities<position>().size() == 10 && frame.components<velocity>()[3].x == 2.0f);
+
+    // The frame keeps its values while the registry moves on
+    reg.get<position>(ids[0]).x = 5.0f;
+    const auto& next = buffer.extract();
+    ADK_CHECK(&next != &frame && next.number() == 2);
+    std::size_t seen = 0;
+    frame.for_each<position>([&](entity e, const position& p) {
+        ADK_CHECK(p.x == 1.0f && reg.valid(e));
+        seen++;
+    });
+    ADK_CHECK(seen == 10);
+    ADK_CHECK(next.components<position>()[0].x == 5.0f);
+}
+
+ADK_TEST(extract_skips_unwritten_pools)
+{
+    registry reg;
+    const auto ids = reg.create_n(10, position{}, velocity{});
+    extract_buffer buffer(reg);
+    settle(buffer);
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 0);
+
+    // A mutable view or get counts as a write of the pools it hands out
+    reg.for_each<position>([](entity, position&) {});
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 1);
+    settle(buffer);
+    reg.get<velocity>(ids[0]);
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 1);
+    settle(buffer);
+    reg.patch<velocity>(ids[0], [](velocity& v) { v.x = 1.0f; });
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 1);
+    settle(buffer);
+    reg.unassign<velocity>(ids[1]);
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 1);
+}
+
+ADK_TEST(extract_read_only_access)
+{
+    registry reg;
+    const auto ids = reg.create_n(10, position{}, velocity{ 1.0f, 0.0f }, sample{});
+    extract_buffer buffer(reg);
+    settle(buffer);
+
+    // Const terms, get<const T>, a const registry and split terms that hand
+    // out no columns read without writing
+    float total = 0.0f;
+    reg.for_each<const position, const velocity, sample>([&](entity, const position& p, const velocity& v) {
+        total += p.x + v.x;
+    });
+    ADK_CHECK(total == 10.0f);
+    ADK_CHECK(reg.get<const velocity>(ids[0]).x == 1.0f);
+    const auto& const_reg = reg;
+    ADK_CHECK(const_reg.get<velocity>(ids[1]).x == 1.0f);
+    reg.for_each<const velocity, adk::ecs::optional<const position>>([](entity, const velocity&, const position* p) {
+        ADK_CHECK(p != nullptr);
+    });
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 0);
+
+    // Mixing in a mutable term only writes that pool
+    reg.for_each<position, const velocity>([](entity, position&, const velocity&) {});
+    buffer.extract();
+    ADK_CHECK(buffer.copied_pools() == 1);
+}
+
+ADK_TEST(extract_scheduler_reads)
+{
+    registry reg;
+    reg.create_n(100, position{}, velocity{ 1.0f, 1.0f });
+    extract_buffer buffer(reg);
+    adk::ecs::thread_pool pool(2);
+    scheduler frame(reg, pool);
+    frame.add<adk::ecs::system<adk::ecs::reads<velocity>, adk::ecs::writes<position>>>(
+        [](entity, const velocity& v, position& p) { p.x += v.x; });
+    settle(buffer);
+    frame.run();
+    buffer.extract();
+    // Only the written pool is copied again
+    ADK_CHECK(buffer.copied_pools() == 1);
+    ADK_CHECK(buffer.latest()->components<position>()[0].x == 1.0f);
+}
@@ -0,0 +1,131 @@
+#include "test.hpp"
+
+#include <atomic>
+#include <random>
+
+using namespace adk::test;
+
+using adk::ecs::exclude;
+using adk::ecs::include;
+using adk::ecs::optional;
+
+namespace
+{
+
+struct dead {};
+
+} // namespace
+
+ADK_TEST(filters_match_brute_force)
+{
+    registry reg;
+    std::mt19937 random(5);
+    std::vector<entity> ids;
+    for (int i = 0; i < 1000; i++) {
+        const auto e = reg.new_entity();
+        ids.push_back(e);
+        if (random() % 4 != 0) {
+            reg.assign<position>(e, position{ float(i), 0.0f });
+        }
+        if (random() % 2 == 0) {
+            reg.assign<velocity>(e, velocity{ float(i), 0.0f });
+        }
+        if (random() % 3 == 0) {
+            reg.assign<health>(e, health{ i });
+        }
+        if (random() % 5 == 0) {
+            reg.assign<dead>(e, dead{});
+        }
+    }
+
+    std::size_t expected = 0;
+    std::size_t expected_with_health = 0;
+    for (const auto e : ids) {
+        if (reg.has<position>(e) && reg.has<velocity>(e) && !reg.has<dead>(e)) {
+            expected++;
+            expected_with_health += reg.has<health>(e);
+        }
+    }
+
+    std::size_t matched = 0;
+    std::size_t with_health = 0;
+    reg.for_each<include<position, velocity>, exclude<dead>, optional<health>>(
+        [&](entity e, position& p, velocity& v, health* h) {
+            ADK_CHECK(!reg.has<dead>(e) && p.x == v.x);
+            ADK_CHECK((h != nullptr) == reg.has<health>(e));
+            if (h != nullptr) {
+                ADK_CHECK(h->value == int(p.x));
+                with_health++;
+            }
+            matched++;
+        });
+    ADK_CHECK(matched == expected && with_health == expected_with_health);
+
+    // Terms can be mixed with plain types in any order
+    matched = 0;
+    reg.for_each<position, exclude<dead, health>, velocity>([&](entity e, position&, velocity&) {
+        ADK_CHECK(!reg.has<dead>(e) && !reg.has<health>(e));
+        matched++;
+    });
+    ADK_CHECK(matched == expected - expected_with_health);
+}
+
+ADK_TEST(filters_optional_writes_through)
+{
+    registry reg;
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<position>(a, position{});
+    reg.assign<position>(b, position{});
+    reg.assign<health>(b, health{ 1 });
+    reg.for_each<position, optional<health>>([](entity, position& p, health* h) {
+        p.x = 1.0f;
+        if (h != nullptr) {
+            h->value = 10;
+        }
+    });
+    ADK_CHECK(reg.get<position>(a).x == 1.0f && reg.get<health>(b).value == 10);
+
+    // An optional component without a pool is always null
+    std::size_t count = 0;
+    reg.for_each<position, optional<velocity>>([&](entity, position&, velocity* v) {
+        ADK_CHECK(v == nullptr);
+        count++;
+    });
+    ADK_CHECK(count == 2);
+}
+
+ADK_TEST(filters_exclude_only_missing_pool)
+{
+    registry reg;
+    reg.create_n(10, position{});
+    // Excluding a type nothing has removes nothing
+    std::size_t count = 0;
+    reg.for_each<position, exclude<velocity>>([&](entity, position&) { count++; });
+    ADK_CHECK(count == 10);
+
+    // Excluded tags use the same mask compare
+    const auto tagged = reg.create_n(5, position{}, frozen{});
+    count = 0;
+    reg.for_each<position, exclude<frozen>>([&](entity e, position&) {
+        ADK_CHECK(!reg.has<frozen>(e));
+        count++;
+    });
+    ADK_CHECK(count == 10);
+    reg.unassign<frozen>(tagged[0]);
+    count = 0;
+    reg.for_each<position, exclude<frozen>>([&](entity, position&) { count++; });
+    ADK_CHECK(count == 11);
+}
+
+ADK_TEST(filters_parallel)
+{
+    registry reg;
+    reg.create_n(5000, position{}, velocity{});
+    const auto doomed = reg.create_n(3000, position{}, velocity{}, dead{});
+    adk::ecs::thread_pool pool(4);
+    std::atomic<std::size_t> count = 0;
+    reg.par_for_each<include<position, velocity>, exclude<dead>>(pool, [&](entity, position&, velocity&) { count++; });
+    ADK_CHECK(count == 5000);
+    ADK_CHECK(reg.has<dead>(doomed[0]));
+}
@@ -0,0 +1,127 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <random>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct mass
+{
+    float value = 0.0f;
+};
+
+struct charge
+{
+    float value = 0.0f;
+};
+
+// Entities that should be in the group, sorted
+std::vector<entity> expected_members(registry& reg, const std::vector<entity>& ids)
+{
+    std::vector<entity> members;
+    for (const auto e : ids) {
+        if (reg.valid(e) && reg.has<mass>(e) && reg.has<charge>(e)) {
+            members.push_back(e);
+        }
+    }
+    std::sort(members.begin(), members.end());
+    return members;
+}
+
+std::vector<entity> group_members(registry& reg)
+{
+    std::vector<entity> members;
+    reg.for_each<mass, charge>([&](entity e, mass& m, charge& c) {
+        // Components were created with matching values, so walking the pools
+        // in lockstep must pair them up
+        ADK_CHECK(m.value == c.value);
+        members.push_back(e);
+    });
+    std::sort(members.begin(), members.end());
+    return members;
+}
+
+} // namespace
+
+ADK_TEST(group_tracks_assign_unassign_and_delete)
+{
+    registry reg;
+    std::vector<entity> ids;
+    for (int i = 0; i < 50; i++) {
+        ids.push_back(reg.new_entity());
+        reg.assign<mass>(ids.back(), mass{ float(i) });
+        if (i % 2 == 0) {
+            reg.assign<charge>(ids.back(), charge{ float(i) });
+        }
+    }
+    reg.group<mass, charge>();
+    ADK_CHECK(group_members(reg) == expected_members(reg, ids));
+    ADK_CHECK(reg.new_view<mass, charge>().size_hint() == 25);
+
+    std::mt19937 random(7);
+    for (int step = 0; step < 500; step++) {
+        const auto index = random() % ids.size();
+        const auto e = ids[index];
+        if (!reg.valid(e)) {
+            ids[index] = reg.new_entity();
+            reg.assign<mass>(ids[index], mass{ float(index) });
+            continue;
+        }
+        switch (random() % 4) {
+            case 0:
+                if (!reg.has<charge>(e)) {
+                    reg.assign<charge>(e, charge{ reg.has<mass>(e) ? reg.get<mass>(e).value : 0.0f });
+                }
+                break;
+            case 1:
+                if (reg.has<charge>(e)) {
+                    reg.unassign<charge>(e);
+                }
+                break;
+            case 2:
+                if (reg.has<mass>(e)) {
+                    reg.unassign<mass>(e);
+                } else {
+                    reg.assign<mass>(e, mass{ reg.has<charge>(e) ? reg.get<charge>(e).value : 0.0f });
+                }
+                break;
+            default:
+                reg.delete_entity(e);
+                break;
+        }
+    }
+    const auto expected = expected_members(reg, ids);
+    ADK_CHECK(group_members(reg) == expected);
+    ADK_CHECK(reg.new_view<mass, charge>().size_hint() == expected.size());
+}
+
+ADK_TEST(group_serves_superset_views)
+{
+    registry reg;
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<mass>(a, mass{ 1.0f });
+    reg.assign<charge>(a, charge{ 1.0f });
+    reg.assign<position>(a, position{ 5.0f, 0.0f });
+    reg.assign<mass>(b, mass{ 2.0f });
+    reg.assign<charge>(b, charge{ 2.0f });
+    reg.group<mass, charge>();
+
+    std::size_t count = 0;
+    reg.for_each<position, mass, charge>([&](entity e, position& p, mass& m, charge&) {
+        ADK_CHECK(e == a && p.x == 5.0f && m.value == 1.0f);
+        count++;
+    });
+    ADK_CHECK(count == 1);
+
+    // Asking for the same group again returns a view of it
+    std::size_t members = 0;
+    for (auto it : reg.group<mass, charge>()) {
+        (void)it;
+        members++;
+    }
+    ADK_CHECK(members == 2);
+}
@@ -0,0 +1,216 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <random>
+
+using namespace adk::test;
+
+namespace
+{
+
+// Every node is visited once, after its parent, with the depth of its parent plus one
+bool consistent(registry& reg, std::size_t expected_nodes)
+{
+    std::vector<entity> visited;
+    std::vector<bool> seen(reg.stats().entity_slots);
+    bool ordered = true;
+    reg.for_each_node([&](entity e, const relationship& node) {
+        if (node.parent != relationship::null) {
+            ordered = ordered && seen[adk::ecs::internal::get_entity_index(node.parent)];
+            ordered = ordered && reg.get<relationship>(node.parent).depth + 1 == node.depth;
+        } else {
+            ordered = ordered && node.depth == 0;
+        }
+        visited.push_back(e);
+        seen[adk::ecs::internal::get_entity_index(e)] = true;
+    });
+    std::size_t levels_total = 0;
+    for (std::size_t depth = 0; depth < reg.hierarchy_depth(); depth++) {
+        for (const auto e : reg.hierarchy_level(depth)) {
+            ordered = ordered && reg.get<relationship>(e).depth == depth;
+        }
+        levels_total += reg.hierarchy_level(depth).size();
+    }
+    std::sort(visited.begin(), visited.end());
+    const bool unique = std::adjacent_find(visited.begin(), visited.end()) == visited.end();
+    return ordered && unique && visited.size() == expected_nodes && levels_total == expected_nodes;
+}
+
+std::vector<entity> children_of(registry& reg, entity e)
+{
+    std::vector<entity> children;
+    reg.for_each_child(e, [&](entity child) { children.push_back(child); });
+    std::sort(children.begin(), children.end());
+    return children;
+}
+
+} // namespace
+
+ADK_TEST(hierarchy_parents_before_children)
+{
+    registry reg;
+    const auto root = reg.new_entity();
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    const auto c = reg.new_entity();
+    // Built leaf first so pool order doesn't match depth order
+    reg.set_parent(c, b);
+    reg.set_parent(b, a);
+    reg.set_parent(a, root);
+    ADK_CHECK(consistent(reg, 4));
+    ADK_CHECK(reg.hierarchy_depth() == 4);
+    ADK_CHECK(reg.parent_of(c) == b && reg.parent_of(root) == relationship::null);
+    ADK_CHECK(reg.get<relationship>(c).depth == 3);
+
+    // Moving a subtree up moves its descendants with it
+    reg.set_parent(b, root);
+    ADK_CHECK(consistent(reg, 4));
+    ADK_CHECK(reg.get<relationship>(c).depth == 2);
+    ADK_CHECK(reg.hierarchy_depth() == 3);
+    ADK_CHECK((children_of(reg, root) == std::vector<entity>{ a, b }));
+
+    reg.set_parent(b, relationship::null);
+    ADK_CHECK(consistent(reg, 4));
+    ADK_CHECK(reg.get<relationship>(c).depth == 1 && reg.hierarchy_level(0).size() == 2);
+}
+
+ADK_TEST(hierarchy_delete_makes_children_roots)
+{
+    registry reg;
+    const auto root = reg.new_entity();
+    const auto middle = reg.new_entity();
+    const auto leaves = reg.create_n(3, position{});
+    reg.set_parent(middle, root);
+    for (const auto leaf : leaves) {
+        reg.set_parent(leaf, middle);
+    }
+    reg.delete_entity(middle);
+    ADK_CHECK(consistent(reg, 4));
+    ADK_CHECK(children_of(reg, root).empty());
+    for (const auto leaf : leaves) {
+        ADK_CHECK(reg.parent_of(leaf) == relationship::null && reg.get<relationship>(leaf).depth == 0);
+    }
+
+    reg.unassign<relationship>(leaves[0]);
+    ADK_CHECK(consistent(reg, 3));
+}
+
+ADK_TEST(hierarchy_destroy_range_duplicates)
+{
+    registry reg;
+    int destroyed = 0;
+    reg.on_destroy<relationship>([&](registry&, entity) { destroyed++; });
+    const auto root = reg.new_entity();
+    const auto c1 = reg.new_entity();
+    const auto c2 = reg.new_entity();
+    const auto c3 = reg.new_entity();
+    reg.set_parent(c1, root);
+    reg.set_parent(c2, root);
+    reg.set_parent(c3, root);
+
+    const entity doomed[] = { c1, c1 };
+    reg.destroy_range(doomed);
+    ADK_CHECK(destroyed == 1);
+    ADK_CHECK(!reg.valid(c1));
+    ADK_CHECK(consistent(reg, 3));
+    ADK_CHECK((children_of(reg, root) == std::vector<entity>{ c2, c3 }));
+    ADK_CHECK(reg.stats().free_slots == 1);
+
+    // Destroying a parent along with one of its children
+    const entity both[] = { root, c2, root };
+    reg.destroy_range(both);
+    ADK_CHECK(destroyed == 3);
+    ADK_CHECK(consistent(reg, 1));
+    ADK_CHECK(reg.parent_of(c3) == relationship::null);
+}
+
+ADK_TEST(hierarchy_deep_chain)
+{
+    // Reparenting walks subtrees without recursing, so depth is only bounded by memory
+    constexpr std::size_t depth = 5000;
+    registry reg;
+    const auto chain = reg.create_n(depth, position{});
+    for (std::size_t i = 1; i < depth; i++) {
+        reg.set_parent(chain[i], chain[i - 1]);
+    }
+    ADK_CHECK(reg.hierarchy_depth() == depth);
+    ADK_CHECK(reg.get<relationship>(chain.back()).depth == depth - 1);
+
+    // Hanging the chain under a new root moves every node down a level
+    const auto top = reg.new_entity();
+    reg.set_parent(chain[0], top);
+    ADK_CHECK(reg.get<relationship>(chain.back()).depth == depth);
+    ADK_CHECK(consistent(reg, depth + 1));
+
+    reg.delete_entity(chain[0]);
+    ADK_CHECK(reg.get<relationship>(chain.back()).depth == depth - 2);
+    ADK_CHECK(reg.hierarchy_depth() == depth - 1);
+}
+
+ADK_TEST(hierarchy_random_reparenting)
+{
+    registry reg;
+    std::mt19937 random(11);
+    std::vector<entity> nodes = reg.create_n(200, position{});
+    for (int step = 0; step < 2000; step++) {
+        const auto child = nodes[random() % nodes.size()];
+        auto parent = nodes[random() % nodes.size()];
+        // Skip cycles
+        for (auto ancestor = parent; ancestor != relationship::null; ancestor = reg.parent_of(ancestor)) {
+            if (ancestor == child) {
+                parent = relationship::null;
+                break;
+            }
+        }
+        reg.set_parent(child, parent);
+        if (step % 100 == 99) {
+            const auto victim = std::find(nodes.begin(), nodes.end(), nodes[random() % nodes.size()]);
+            reg.delete_entity(*victim);
+            nodes.erase(victim);
+        }
+    }
+    ADK_CHECK(consistent(reg, nodes.size()));
+}
+
+ADK_TEST(hierarchy_snapshot_round_trip)
+{
+    registry reg;
+    const auto ids = reg.create_n(4, position{});
+    reg.set_parent(ids[3], ids[2]);
+    reg.set_parent(ids[2], ids[1]);
+    reg.set_parent(ids[1], ids[0]);
+    std::vector<std::byte> frame;
+    reg.snapshot<position, relationship>(frame);
+
+    registry restored;
+    ADK_CHECK(restored.restore<position, relationship>(frame));
+    ADK_CHECK(consistent(restored, 4));
+    ADK_CHECK(restored.parent_of(ids[3]) == ids[2]);
+    restored.set_parent(ids[3], ids[0]);
+    ADK_CHECK(consistent(restored, 4));
+}
+
+// Nodes can only be added through set_parent, relationships passed to
+// create_n, assign or a command buffer don't compile
+ADK_TEST(hierarchy_nodes_from_set_parent)
+{
+    registry reg;
+    std::size_t constructed = 0;
+    reg.on_construct<relationship>([&](registry& r, entity e) {
+        // The node is already in its level when listeners run
+        ADK_CHECK(r.get<relationship>(e).depth == 0);
+        constructed++;
+    });
+    const auto ids = reg.create_n(3, position{});
+    const auto root = reg.new_entity();
+    reg.set_parent(ids[0], root);
+    reg.set_parent(ids[1], ids[0]);
+    ADK_CHECK(constructed == 3);
+    ADK_CHECK(consistent(reg, 3));
+    ADK_CHECK(reg.hierarchy_level(0).size() == 1 && reg.hierarchy_level(2).size() == 1);
+
+    // Entities outside of the hierarchy are deleted without touching it
+    reg.delete_entity(ids[2]);
+    reg.delete_entity(ids[0]);
+    ADK_CHECK(consistent(reg, 2));
+}
@@ -0,0 +1,97 @@
+#include "test.hpp"
+
+#include <cstdint>
+#include <memory_resource>
+
+using namespace adk::test;
+
+namespace
+{
+
+// Makes any allocation from the default memory resource throw while in scope
+struct default_resource_guard
+{
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+    ~default_resource_guard()
+    {
+        std::pmr::set_default_resource(previous);
+    }
+};
+
+void exercise(registry& reg)
+{
+    entity ids[200];
+    reg.create_n(std::span<entity>(ids), position{}, health{ 1 });
+    reg.destroy_range(std::span<const entity>(ids, 100));
+    reg.assign<velocity>(ids[150], velocity{});
+    reg.sort<health>([](const health& a, const health& b) { return a.value < b.value; });
+    reg.group<position, velocity>();
+    reg.compact();
+}
+
+} // namespace
+
+ADK_TEST(memory_registry_uses_only_its_resource)
+{
+    adk::ecs::counting_resource upstream;
+    {
+        default_resource_guard guard;
+        registry reg(&upstream);
+        exercise(reg);
+        ADK_CHECK(upstream.stats().bytes_in_use > 0);
+        ADK_CHECK(reg.memory_usage().bytes_in_use == upstream.stats().bytes_in_use - sizeof(adk::ecs::counting_resource));
+        ADK_CHECK(reg.memory_usage().allocations > 0);
+    }
+    // Everything is given back when the registry goes away
+    ADK_CHECK(upstream.stats().bytes_in_use == 0);
+}
+
+ADK_TEST(memory_bump_arena)
+{
+    adk::ecs::counting_resource upstream;
+    adk::ecs::bump_arena arena(16 * 1024, &upstream);
+    {
+        registry reg(&arena);
+        exercise(reg);
+        ADK_CHECK(arena.bytes_used() > 0);
+        ADK_CHECK(arena.bytes_reserved() >= arena.bytes_used());
+    }
+    ADK_CHECK(upstream.stats().bytes_in_use == arena.bytes_reserved());
+    arena.release();
+    ADK_CHECK(upstream.stats().bytes_in_use == 0);
+    ADK_CHECK(arena.bytes_used() == 0);
+
+    // Alignment is honoured
+    const auto memory = static_cast<std::pmr::memory_resource&>(arena).allocate(24, 64);
+    ADK_CHECK(reinterpret_cast<std::uintptr_t>(memory) % 64 == 0);
+}
+
+ADK_TEST(memory_size_class_pool)
+{
+    adk::ecs::counting_resource upstream;
+    adk::ecs::size_class_pool pool(64 * 1024, &upstream);
+    auto& resource = static_cast<std::pmr::memory_resource&>(pool);
+
+    const auto a = resource.allocate(24, 8);
+    ADK_CHECK(pool.bytes_used() == 32);
+    ADK_CHECK(reinterpret_cast<std::uintptr_t>(a) % 32 == 0);
+    resource.deallocate(a, 24, 8);
+    ADK_CHECK(pool.bytes_used() == 0);
+    // Freed blocks are reused before new chunks are taken
+    ADK_CHECK(resource.allocate(20, 8) == a);
+    const auto reserved = pool.bytes_reserved();
+
+    // Large allocations bypass the pool
+    const auto large = resource.allocate(10000, 16);
+    ADK_CHECK(pool.bytes_reserved() == reserved);
+    resource.deallocate(large, 10000, 16);
+
+    {
+        registry reg(&pool);
+        exercise(reg);
+    }
+    ADK_CHECK(pool.bytes_used() == 32);
+    pool.release();
+    ADK_CHECK(upstream.stats().bytes_in_use == 0);
+}
@@ -0,0 +1,65 @@
+#include "test.hpp"
+
+#include <cstdint>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct inventory
+{
+    int slots[16] = {};
+};
+
+} // namespace
+
+template <>
+struct adk::ecs::component_traits<inventory>
+{
+    static constexpr std::size_t page_size = 64;
+};
+
+ADK_TEST(paged_references_survive_growth)
+{
+    registry reg;
+    const auto first = reg.new_entity();
+    auto& component = reg.assign<inventory>(first, inventory{});
+    component.slots[0] = 42;
+    const auto address = &component;
+
+    const auto ids = reg.create_n(1000, inventory{});
+    ADK_CHECK(&reg.get<inventory>(first) == address);
+    ADK_CHECK(address->slots[0] == 42);
+
+    // Pages are aligned to their size once they are at least 4 KB
+    static_assert(64 * sizeof(inventory) == 4096);
+    ADK_CHECK(reinterpret_cast<std::uintptr_t>(address) % 4096 == 0);
+
+    // Removal still moves the last component into the hole
+    reg.get<inventory>(ids.back()).slots[0] = 7;
+    reg.unassign<inventory>(first);
+    ADK_CHECK(address->slots[0] == 7);
+    ADK_CHECK(reg.get<inventory>(ids.back()).slots[0] == 7);
+}
+
+ADK_TEST(paged_iteration_and_shrink)
+{
+    registry reg;
+    const auto ids = reg.create_n(300, inventory{});
+    int total = 0;
+    reg.for_each<inventory>([&](entity, inventory& i) {
+        i.slots[1] = 1;
+        total++;
+    });
+    ADK_CHECK(total == 300);
+
+    reg.destroy_range(std::span(ids).subspan(0, 250));
+    reg.compact();
+    const auto stats = reg.stats();
+    ADK_CHECK(stats.pools.size() == 1);
+    ADK_CHECK(stats.pools[0].size == 50);
+    ADK_CHECK(stats.pools[0].capacity == 64);
+    reg.for_each<inventory>([&](entity, inventory& i) { total -= i.slots[1]; });
+    ADK_CHECK(total == 250);
+}
@@ -0,0 +1,103 @@
+#include "test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace adk::test;
+
+ADK_TEST(parallel_for_covers_range_once)
+{
+    adk::ecs::thread_pool pool(3);
+    constexpr std::size_t count = 10000;
+    std::vector<std::atomic<int>> hits(count);
+    auto func = [&](std::size_t begin, std::size_t end) {
+        ADK_CHECK(pool.thread_index() < pool.concurrency());
+        for (std::size_t i = begin; i < end; i++) {
+            hits[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    pool.parallel_for(count, 64, func);
+    bool once = true;
+    for (const auto& hit : hits) {
+        once = once && hit.load() == 1;
+    }
+    ADK_CHECK(once);
+}
+
+ADK_TEST(parallel_pool_without_workers_runs_inline)
+{
+    adk::ecs::thread_pool pool(0);
+    ADK_CHECK(pool.concurrency() == 1);
+    std::size_t total = 0;
+    auto func = [&](std::size_t begin, std::size_t end) { total += end - begin; };
+    pool.parallel_for(1000, 10, func);
+    ADK_CHECK(total == 1000);
+}
+
+ADK_TEST(parallel_for_rethrows_after_every_chunk)
+{
+    adk::ecs::thread_pool pool(3);
+    std::atomic<int> running = 0;
+    auto func = [&](std::size_t begin, std::size_t) {
+        running.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        running.fetch_sub(1);
+        if (begin % 3 == 0) {
+            throw std::runtime_error("chunk failed");
+        }
+    };
+    bool thrown = false;
+    try {
+        pool.parallel_for(64, 1, func);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    // Nothing still runs once the exception reaches the caller
+    ADK_CHECK(thrown && running.load() == 0);
+
+    // And the pool keeps working
+    std::atomic<std::size_t> total = 0;
+    auto sum = [&](std::size_t begin, std::size_t end) { total.fetch_add(end - begin); };
+    pool.parallel_for(1000, 10, sum);
+    ADK_CHECK(total.load() == 1000);
+}
+
+ADK_TEST(parallel_for_each_visits_every_match_once)
+{
+    registry reg;
+    const auto ids = reg.create_n(20000, health{ 0 });
+    for (std::size_t i = 0; i < ids.size(); i += 2) {
+        reg.assign<velocity>(ids[i], velocity{ 1.0f, 0.0f });
+    }
+
+    adk::ecs::thread_pool pool(3);
+    std::atomic<std::size_t> calls = 0;
+    reg.par_for_each<health, velocity>(pool, [&](entity, health& h, velocity&) {
+        h.value++;
+        calls.fetch_add(1, std::memory_order_relaxed);
+    });
+    ADK_CHECK(calls.load() == ids.size() / 2);
+    bool correct = true;
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        correct = correct && reg.get<health>(ids[i]).value == (i % 2 == 0 ? 1 : 0);
+    }
+    ADK_CHECK(correct);
+}
+
+ADK_TEST(parallel_view_chunks_are_disjoint)
+{
+    registry reg;
+    reg.create_n(5000, position{});
+    auto chunks = reg.new_par_view<position>();
+    ADK_CHECK(chunks.size() > 1);
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        auto chunk = chunks[i];
+        for (auto it = chunk.begin(); it != chunk.end(); ++it) {
+            total++;
+        }
+    }
+    ADK_CHECK(total == 5000);
+}
@@ -0,0 +1,104 @@
+#include "test.hpp"
+
+#include <memory>
+
+using namespace adk::test;
+
+namespace
+{
+
+// Counts live instances so leaks and double destroys show up
+struct counted
+{
+    static inline int alive = 0;
+    std::shared_ptr<int> payload;
+
+    counted() { alive++; }
+    counted(const counted& other) : payload(other.payload) { alive++; }
+    counted(counted&& other) noexcept : payload(std::move(other.payload)) { alive++; }
+    counted& operator=(const counted&) = default;
+    counted& operator=(counted&&) = default;
+    ~counted() { alive--; }
+};
+
+} // namespace
+
+ADK_TEST(prefab_instantiates_components)
+{
+    registry reg;
+    prefab enemy;
+    enemy.set(position{ 1.0f, 2.0f }).set(health{ 50 }).set(frozen{});
+    ADK_CHECK(enemy.has<position>() && enemy.has<frozen>() && !enemy.has<velocity>());
+
+    const auto wave = reg.instantiate(enemy, 100);
+    ADK_CHECK(wave.size() == 100);
+    bool correct = true;
+    for (const auto e : wave) {
+        correct = correct && reg.valid(e) && reg.has<frozen>(e) && !reg.has<velocity>(e);
+        correct = correct && reg.get<position>(e).y == 2.0f && reg.get<health>(e).value == 50;
+    }
+    ADK_CHECK(correct);
+
+    // Changing the prefab only affects later instances
+    enemy.get<health>().value = 80;
+    enemy.set(health{ 90 });
+    const auto next = reg.instantiate(enemy, 1);
+    ADK_CHECK(reg.get<health>(next[0]).value == 90);
+    ADK_CHECK(reg.get<health>(wave[0]).value == 50);
+
+    std::size_t count = 0;
+    reg.for_each<position, health, frozen>([&](entity, position&, health&, frozen&) { count++; });
+    ADK_CHECK(count == 101);
+}
+
+ADK_TEST(prefab_reuses_free_slots_and_groups)
+{
+    registry reg;
+    reg.group<position, velocity>();
+    const auto old = reg.create_n(10, position{});
+    reg.destroy_range(old);
+
+    prefab mover;
+    mover.set(position{}).set(velocity{ 1.0f, 0.0f });
+    reg.instantiate(mover, 20);
+    ADK_CHECK(reg.stats().entity_slots == 20);
+    ADK_CHECK(reg.new_view<position, velocity>().size_hint() == 20);
+
+    int constructed = 0;
+    reg.on_construct<velocity>([&](registry& r, entity e) {
+        ADK_CHECK(r.has<position>(e));
+        constructed++;
+    });
+    entity out[5];
+    reg.instantiate(mover, std::span<entity>(out));
+    ADK_CHECK(constructed == 5);
+    ADK_CHECK(reg.new_view<position, velocity>().size_hint() == 25);
+}
+
+ADK_TEST(prefab_owns_its_values)
+{
+    {
+        registry reg;
+        prefab bundle;
+        counted value;
+        value.payload = std::make_shared<int>(7);
+        bundle.set(value);
+        bundle.set(value);
+        ADK_CHECK(counted::alive == 2);
+
+        const auto ids = reg.instantiate(bundle, 3);
+        ADK_CHECK(counted::alive == 5);
+        ADK_CHECK(*reg.get<counted>(ids[2]).payload == 7);
+        ADK_CHECK(value.payload.use_count() == 5);
+
+        // Moving hands over the values without copying them
+        prefab moved(std::move(bundle));
+        ADK_CHECK(counted::alive == 5 && !bundle.has<counted>() && moved.has<counted>());
+        bundle = std::move(moved);
+        ADK_CHECK(counted::alive == 5 && bundle.has<counted>());
+
+        bundle.clear();
+        ADK_CHECK(counted::alive == 4 && !bundle.has<counted>());
+    }
+    ADK_CHECK(counted::alive == 0);
+}
@@ -0,0 +1,134 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace adk::test;
+
+ADK_TEST(reserve_valid_after_flush)
+{
+    registry reg;
+    const auto existing = reg.new_entity();
+    const auto a = reg.reserve_entity();
+    const auto b = reg.reserve_entity();
+    ADK_CHECK(a != b && a != existing && b != existing);
+    ADK_CHECK(!reg.valid(a) && !reg.valid(b));
+
+    reg.flush_reserved();
+    ADK_CHECK(reg.valid(a) && reg.valid(b));
+    reg.assign<health>(a, health{ 3 });
+    ADK_CHECK(reg.get<health>(a).value == 3);
+
+    // new_entity doesn't hand out anything that was reserved
+    const auto c = reg.reserve_entity();
+    const auto d = reg.new_entity();
+    reg.flush_reserved();
+    ADK_CHECK(c != d && reg.valid(c) && reg.valid(d));
+    ADK_CHECK(reg.stats().live_entities == 5);
+}
+
+ADK_TEST(reserve_reuses_free_slots_after_flush)
+{
+    registry reg;
+    const auto ids = reg.create_n(10, position{});
+    reg.destroy_range(std::span(ids).subspan(0, 4));
+    // A flush sets aside as many free slots as it used up, the first
+    // reservations only have new indexes to take
+    for (int i = 0; i < 4; i++) {
+        ADK_CHECK(adk::ecs::internal::get_entity_index(reg.reserve_entity()) >= 10);
+    }
+    reg.flush_reserved();
+    std::vector<entity> reserved;
+    for (int i = 0; i < 6; i++) {
+        reserved.push_back(reg.reserve_entity());
+    }
+    reg.flush_reserved();
+    ADK_CHECK(reg.stats().entity_slots == 16);
+    ADK_CHECK(reg.stats().free_slots == 0);
+    bool recycled = true;
+    for (int i = 0; i < 4; i++) {
+        const auto index = adk::ecs::internal::get_entity_index(reserved[i]);
+        recycled = recycled && index < 4 && reserved[i] != ids[index];
+    }
+    ADK_CHECK(recycled);
+    ADK_CHECK(std::all_of(reserved.begin(), reserved.end(), [&](entity e) { return reg.valid(e); }));
+}
+
+ADK_TEST(reserve_from_threads)
+{
+    registry reg;
+    const auto ids = reg.create_n(300, position{});
+    reg.destroy_range(std::span(ids).subspan(0, 100));
+    reg.flush_reserved();
+
+    constexpr int threads = 4;
+    constexpr int per_thread = 500;
+    std::vector<std::vector<entity>> results(threads);
+    {
+        std::vector<std::jthread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&reg, &results, t]() {
+                for (int i = 0; i < per_thread; i++) {
+                    results[t].push_back(reg.reserve_entity());
+                }
+            });
+        }
+        // The main thread can keep reading the registry meanwhile
+        reg.for_each<position>([](entity, position& p) { p.x += 1.0f; });
+    }
+    reg.flush_reserved();
+
+    std::vector<entity> all;
+    for (const auto& result : results) {
+        all.insert(all.end(), result.begin(), result.end());
+    }
+    std::sort(all.begin(), all.end());
+    ADK_CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+    ADK_CHECK(std::all_of(all.begin(), all.end(), [&](entity e) { return reg.valid(e); }));
+    ADK_CHECK(reg.stats().live_entities == 200 + threads * per_thread);
+    ADK_CHECK(reg.stats().free_slots == 0);
+}
+
+ADK_TEST(reserve_with_command_buffer)
+{
+    registry reg;
+    command_buffer buffer;
+    const auto e = reg.reserve_entity();
+    buffer.add(e, position{ 4.0f, 0.0f });
+    buffer.add(e, frozen{});
+    // Playback flushes reservations before applying commands
+    reg.playback(buffer);
+    ADK_CHECK(reg.valid(e) && reg.has<frozen>(e));
+    ADK_CHECK(reg.get<position>(e).x == 4.0f);
+}
+
+ADK_TEST(reserve_dropped_by_restore)
+{
+    registry reg;
+    reg.create_n(3, position{});
+    std::vector<std::byte> frame;
+    reg.snapshot<position>(frame);
+    const auto pending = reg.reserve_entity();
+    ADK_CHECK(reg.restore<position>(frame));
+    reg.flush_reserved();
+    ADK_CHECK(!reg.valid(pending));
+    ADK_CHECK(reg.stats().live_entities == 3);
+}
+
+ADK_TEST(reserve_set_aside_slot_keeps_version)
+{
+    registry reg;
+    reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.delete_entity(b);
+    // The flush sets aside b's slot for the next reservation
+    reg.reserve_entity();
+    reg.flush_reserved();
+
+    std::vector<std::byte> frame;
+    reg.snapshot<position>(frame);
+    ADK_CHECK(reg.restore<position>(frame));
+    const auto c = reg.new_entity();
+    ADK_CHECK(adk::ecs::internal::get_entity_index(c) == adk::ecs::internal::get_entity_index(b));
+    ADK_CHECK(c != b && !reg.valid(b));
+}
@@ -0,0 +1,134 @@
+#include "test.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct frame_time
+{
+    double seconds = 0.0;
+};
+
+struct settings
+{
+    std::string name;
+    int quality = 0;
+
+    settings(std::string name, int quality) : name(std::move(name)), quality(quality) {}
+};
+
+// Counts live instances so replaced and removed resources can be checked
+struct tracked_resource
+{
+    static inline int alive = 0;
+    int value = 0;
+
+    explicit tracked_resource(int value) : value(value) { alive++; }
+    tracked_resource(const tracked_resource&) = delete;
+    ~tracked_resource() { alive--; }
+};
+
+template <int N>
+struct filler {};
+
+struct picky_resource
+{
+    int value = 0;
+
+    explicit picky_resource(int value) : value(value)
+    {
+        if (value < 0) {
+            throw std::invalid_argument("negative");
+        }
+    }
+};
+
+} // namespace
+
+ADK_TEST(resources_set_and_get)
+{
+    registry reg;
+    ADK_CHECK(reg.try_resource<frame_time>() == nullptr);
+    auto& time = reg.set_resource<frame_time>(frame_time{ 0.016 });
+    ADK_CHECK(&reg.resource<frame_time>() == &time);
+    ADK_CHECK(reg.try_resource<frame_time>() == &time);
+
+    // Constructed in place from the arguments
+    reg.set_resource<settings>("high", 3);
+    const auto& const_reg = reg;
+    ADK_CHECK(const_reg.resource<settings>().name == "high" && const_reg.try_resource<settings>()->quality == 3);
+
+    reg.resource<frame_time>().seconds = 0.033;
+    ADK_CHECK(time.seconds == 0.033);
+
+    // Resources aren't components
+    ADK_CHECK(reg.stats().pools.empty());
+    std::size_t count = 0;
+    reg.for_each<frame_time>([&](entity, frame_time&) { count++; });
+    ADK_CHECK(count == 0);
+}
+
+ADK_TEST(resources_references_are_stable)
+{
+    registry reg;
+    auto& time = reg.set_resource<frame_time>();
+    // Adding other resources doesn't move existing ones
+    reg.set_resource<filler<1>>();
+    reg.set_resource<filler<2>>();
+    reg.set_resource<filler<3>>();
+    reg.set_resource<filler<4>>();
+    reg.remove_resource<filler<2>>();
+    ADK_CHECK(&reg.resource<frame_time>() == &time);
+
+    // Nor does moving the registry
+    registry moved(std::move(reg));
+    ADK_CHECK(&moved.resource<frame_time>() == &time);
+    ADK_CHECK(moved.try_resource<filler<2>>() == nullptr && moved.try_resource<filler<3>>() != nullptr);
+}
+
+ADK_TEST(resources_replace_and_remove)
+{
+    adk::ecs::counting_resource upstream;
+    {
+        registry reg(&upstream);
+        reg.set_resource<tracked_resource>(1);
+        reg.set_resource<tracked_resource>(2);
+        ADK_CHECK(tracked_resource::alive == 1 && reg.resource<tracked_resource>().value == 2);
+
+        reg.remove_resource<tracked_resource>();
+        ADK_CHECK(tracked_resource::alive == 0 && reg.try_resource<tracked_resource>() == nullptr);
+        // Removing one that isn't set does nothing
+        reg.remove_resource<tracked_resource>();
+        reg.remove_resource<frame_time>();
+
+        reg.set_resource<tracked_resource>(3);
+        ADK_CHECK(tracked_resource::alive == 1);
+    }
+    // Destroyed along with the registry and allocated from its resource
+    ADK_CHECK(tracked_resource::alive == 0);
+    ADK_CHECK(upstream.stats().bytes_in_use == 0);
+}
+
+ADK_TEST(resources_replace_from_old_value)
+{
+    registry reg;
+    reg.set_resource<settings>(std::string(64, 'a'), 2);
+    // The new value is built before the old one is destroyed
+    reg.set_resource<settings>(reg.resource<settings>());
+    ADK_CHECK(reg.resource<settings>().name == std::string(64, 'a') && reg.resource<settings>().quality == 2);
+
+    // A throwing constructor leaves the old value in place
+    auto& old = reg.set_resource<picky_resource>(5);
+    bool thrown = false;
+    try {
+        reg.set_resource<picky_resource>(-1);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ADK_CHECK(thrown && &reg.resource<picky_resource>() == &old && old.value == 5);
+}
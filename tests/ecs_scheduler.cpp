@@ -0,0 +1,104 @@
+#include "test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace adk::test;
+
+using move_system = adk::ecs::system<adk::ecs::reads<velocity>, adk::ecs::writes<position>>;
+using damage_system = adk::ecs::system<adk::ecs::reads<>, adk::ecs::writes<health>>;
+using drag_system = adk::ecs::system<adk::ecs::reads<>, adk::ecs::writes<velocity>>;
+
+static_assert(!adk::ecs::systems_conflict<move_system, damage_system>);
+static_assert(adk::ecs::systems_conflict<move_system, drag_system>);
+static_assert(adk::ecs::systems_conflict<drag_system, move_system>);
+static_assert(adk::ecs::systems_conflict<move_system, move_system>);
+
+ADK_TEST(scheduler_runs_per_entity_systems)
+{
+    registry reg;
+    const auto ids = reg.create_n(100, position{}, velocity{ 1.0f, 2.0f }, health{ 10 });
+    adk::ecs::thread_pool pool(2);
+    scheduler frame(reg, pool);
+    frame.add<move_system>([](entity, const velocity& v, position& p) {
+        p.x += v.x;
+        p.y += v.y;
+    }, "move");
+    frame.add<damage_system>([](entity, health& h) { h.value--; }, "damage");
+    ADK_CHECK(frame.size() == 2);
+
+    frame.run();
+    frame.run();
+    bool correct = true;
+    for (const auto e : ids) {
+        correct = correct && reg.get<position>(e).x == 2.0f && reg.get<position>(e).y == 4.0f
+            && reg.get<health>(e).value == 8;
+    }
+    ADK_CHECK(correct);
+
+    const auto stats = frame.stats();
+    ADK_CHECK(stats.size() == 2 && stats[0].name == "move" && stats[1].name == "damage");
+}
+
+ADK_TEST(scheduler_orders_conflicting_systems)
+{
+    registry reg;
+    const auto e = reg.new_entity();
+    reg.assign<position>(e, position{});
+    reg.assign<velocity>(e, velocity{});
+    adk::ecs::thread_pool pool(3);
+    scheduler frame(reg, pool);
+
+    // Each system writes what the next one reads, so they must run in the
+    // order they were added whatever the number of threads
+    frame.add<drag_system>([e](registry& reg) { reg.get<velocity>(e).x = 3.0f; });
+    frame.add<move_system>([](entity, const velocity& v, position& p) { p.x = v.x * 2.0f; });
+    frame.add<drag_system>([e](registry& reg) { reg.get<velocity>(e).x = 100.0f; });
+    for (int i = 0; i < 20; i++) {
+        frame.run();
+        ADK_CHECK(reg.get<position>(e).x == 6.0f);
+    }
+}
+
+ADK_TEST(scheduler_runs_independent_systems)
+{
+    registry reg;
+    adk::ecs::thread_pool pool(3);
+    scheduler frame(reg, pool);
+    std::atomic<int> runs = 0;
+    for (int i = 0; i < 16; i++) {
+        frame.add<adk::ecs::system<adk::ecs::reads<position>>>([&runs](registry&) { runs++; });
+    }
+    frame.run();
+    ADK_CHECK(runs.load() == 16);
+}
+
+ADK_TEST(scheduler_rethrows_after_every_system)
+{
+    registry reg;
+    adk::ecs::thread_pool pool(3);
+    scheduler frame(reg, pool);
+    std::atomic<int> running = 0;
+    for (int i = 0; i < 16; i++) {
+        frame.add<adk::ecs::system<adk::ecs::reads<position>>>([&running, i](registry&) {
+            running++;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            running--;
+            if (i % 3 == 0) {
+                throw std::runtime_error("system failed");
+            }
+        });
+    }
+    for (int i = 0; i < 5; i++) {
+        bool thrown = false;
+        try {
+            frame.run();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        // Nothing still runs once the exception reaches the caller
+        ADK_CHECK(thrown && running.load() == 0);
+    }
+}
@@ -0,0 +1,98 @@
+#include "test.hpp"
+
+#include <random>
+#include <utility>
+
+using namespace adk::test;
+
+namespace
+{
+
+template <std::size_t bits>
+void check_block_matches(std::mt19937_64& random)
+{
+    using signature = adk::ecs::internal::signature<bits>;
+    std::vector<signature> signatures(adk::ecs::internal::SIGNATURE_BLOCK);
+    signature care;
+    signature wanted;
+    for (std::size_t word = 0; word < signature::word_count; word++) {
+        // Sparse masks so that a fair share of signatures match
+        care.words[word] = random() & random() & random();
+        wanted.words[word] = care.words[word] & random();
+    }
+    for (std::size_t i = 0; i < signatures.size(); i++) {
+        for (std::size_t word = 0; word < signature::word_count; word++) {
+            signatures[i].words[word] = i % 3 == 0 ? (wanted.words[word] | (random() & ~care.words[word])) : random();
+        }
+    }
+    for (std::size_t count = 0; count <= signatures.size(); count += 7) {
+        const auto matches = adk::ecs::internal::match_signatures(signatures.data(), count, care, wanted);
+        bool agree = true;
+        for (std::size_t i = 0; i < 64; i++) {
+            const bool expected = i < count && signatures[i].matches(care, wanted);
+            agree = agree && ((matches >> i) & 1) == expected;
+        }
+        ADK_CHECK(agree);
+    }
+}
+
+template <int N>
+struct wide
+{
+    int value = N;
+};
+
+} // namespace
+
+ADK_TEST(signature_block_matches_agree_with_scalar)
+{
+    std::mt19937_64 random(42);
+    for (int i = 0; i < 20; i++) {
+        check_block_matches<64>(random);
+        check_block_matches<128>(random);
+        check_block_matches<256>(random);
+        check_block_matches<512>(random);
+    }
+}
+
+ADK_TEST(signature_bits_past_64)
+{
+    registry reg;
+    const auto e = reg.new_entity();
+    const auto other = reg.new_entity();
+    [&]<int... N>(std::integer_sequence<int, N...>) {
+        (reg.assign<wide<N>>(e, wide<N>{}), ...);
+    }(std::make_integer_sequence<int, 80>());
+    ADK_CHECK(adk::ecs::internal::get_component_id<wide<79>>() >= 64);
+
+    // A component past bit 64 must not alias a low bit
+    reg.assign<wide<79>>(other, wide<79>{});
+    ADK_CHECK(reg.has<wide<79>>(other));
+    ADK_CHECK(!reg.has<wide<79 - 64>>(other));
+    ADK_CHECK(!reg.has<wide<0>>(other));
+
+    std::size_t count = 0;
+    reg.for_each<wide<0>, wide<79>>([&](entity match, wide<0>&, wide<79>& component) {
+        ADK_CHECK(match == e && component.value == 79);
+        count++;
+    });
+    ADK_CHECK(count == 1);
+}
+
+ADK_TEST(signature_tag_scan)
+{
+    registry reg;
+    const auto ids = reg.create_n(300);
+    for (std::size_t i = 0; i < ids.size(); i += 3) {
+        reg.assign<frozen>(ids[i], frozen{});
+    }
+    reg.delete_entity(ids[3]);
+
+    // Only tags, so the view scans signatures a block at a time
+    std::size_t count = 0;
+    reg.for_each<frozen>([&](entity e, frozen&) {
+        ADK_CHECK(reg.valid(e));
+        count++;
+    });
+    ADK_CHECK(count == 99);
+}
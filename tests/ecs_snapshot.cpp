@@ -0,0 +1,262 @@
+#include "test.hpp"
+
+#include <adk/adk_reflect.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+using namespace adk::test;
+
+namespace
+{
+
+// Not trivially copyable, so snapshots go through its reflected members
+struct stats_block
+{
+    int level = 0;
+    float speed = 0.0f;
+
+    stats_block() = default;
+    stats_block(int level, float speed) : level(level), speed(speed) {}
+    stats_block(const stats_block& other) : level(other.level), speed(other.speed) {}
+    stats_block& operator=(const stats_block& other)
+    {
+        level = other.level;
+        speed = other.speed;
+        return *this;
+    }
+};
+
+struct marked {};
+
+} // namespace
+
+ADK_REFLECT_CLASS(stats_block, level, speed)
+
+namespace
+{
+
+std::vector<entity> build(registry& reg)
+{
+    const auto ids = reg.create_n(50, position{ 1.0f, 2.0f });
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        if (i % 2 == 0) {
+            reg.assign<stats_block>(ids[i], stats_block{ int(i), float(i) / 2.0f });
+        }
+        if (i % 5 == 0) {
+            reg.assign<marked>(ids[i], marked{});
+        }
+        reg.get<position>(ids[i]).x = float(i);
+    }
+    reg.delete_entity(ids[7]);
+    reg.delete_entity(ids[3]);
+    return ids;
+}
+
+// Copy of data with value written over the bytes at offset
+template <typename T>
+std::vector<std::byte> patched(const std::vector<std::byte>& data, std::size_t offset, T value)
+{
+    auto copy = data;
+    std::memcpy(copy.data() + offset, &value, sizeof(value));
+    return copy;
+}
+
+bool same_state(registry& reg, const std::vector<entity>& ids)
+{
+    bool same = true;
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        const auto e = ids[i];
+        if (i == 3 || i == 7) {
+            same = same && !reg.valid(e);
+            continue;
+        }
+        same = same && reg.valid(e) && reg.get<position>(e).x == float(i);
+        same = same && reg.has<stats_block>(e) == (i % 2 == 0) && reg.has<marked>(e) == (i % 5 == 0);
+        if (i % 2 == 0) {
+            same = same && reg.get<stats_block>(e).level == int(i) && reg.get<stats_block>(e).speed == float(i) / 2.0f;
+        }
+    }
+    return same;
+}
+
+} // namespace
+
+ADK_TEST(snapshot_buffer_round_trip)
+{
+    registry reg;
+    const auto ids = build(reg);
+    std::vector<std::byte> buffer;
+    reg.snapshot<position, stats_block, marked>(buffer);
+
+    registry restored;
+    ADK_CHECK(restored.restore<position, stats_block, marked>(buffer));
+    ADK_CHECK(same_state(restored, ids));
+    ADK_CHECK(restored.stats().free_slots == 2);
+
+    // The free list comes back too, so both registries hand out the same ids
+    ADK_CHECK(restored.new_entity() == reg.new_entity());
+    ADK_CHECK(restored.new_entity() == reg.new_entity());
+    ADK_CHECK(restored.new_entity() == reg.new_entity());
+}
+
+ADK_TEST(snapshot_stream_round_trip)
+{
+    registry reg;
+    const auto ids = build(reg);
+    std::stringstream stream;
+    reg.snapshot<position, stats_block, marked>(stream);
+
+    registry restored;
+    ADK_CHECK(restored.restore<position, stats_block, marked>(stream));
+    ADK_CHECK(same_state(restored, ids));
+}
+
+ADK_TEST(snapshot_rollback)
+{
+    registry reg;
+    const auto ids = build(reg);
+    std::vector<std::byte> frame;
+    reg.snapshot<position, stats_block, marked>(frame);
+
+    reg.get<position>(ids[0]).x = 100.0f;
+    reg.unassign<stats_block>(ids[2]);
+    reg.delete_entity(ids[10]);
+    reg.create_n(20, health{});
+    ADK_CHECK(!same_state(reg, ids));
+
+    // Pools of types that weren't saved are emptied
+    ADK_CHECK(reg.restore<position, stats_block, marked>(frame));
+    ADK_CHECK(same_state(reg, ids));
+    std::size_t count = 0;
+    reg.for_each<health>([&](entity, health&) { count++; });
+    ADK_CHECK(count == 0);
+}
+
+ADK_TEST(snapshot_rebuilds_groups)
+{
+    registry reg;
+    const auto ids = build(reg);
+    reg.group<position, stats_block>();
+    std::vector<std::byte> frame;
+    reg.snapshot<position, stats_block, marked>(frame);
+    reg.destroy_range(std::span(ids).subspan(20, 10));
+    ADK_CHECK(reg.restore<position, stats_block, marked>(frame));
+
+    std::size_t count = 0;
+    reg.for_each<position, stats_block>([&](entity e, position& p, stats_block& s) {
+        ADK_CHECK(p.x == float(s.level) && ids[s.level] == e);
+        count++;
+    });
+    ADK_CHECK(count == 25);
+    ADK_CHECK(reg.new_view<position, stats_block>().size_hint() == 25);
+}
+
+ADK_TEST(snapshot_rejects_mismatched_data)
+{
+    registry reg;
+    const auto ids = build(reg);
+    std::vector<std::byte> buffer;
+    reg.snapshot<position, stats_block>(buffer);
+
+    // A different type count is caught by the header and leaves the registry alone
+    registry other;
+    const auto mine = other.create_n(3, health{ 9 });
+    ADK_CHECK(!other.restore<position>(buffer));
+    ADK_CHECK(other.valid(mine[2]) && other.get<health>(mine[2]).value == 9);
+
+    // A type of a different size is caught by its size field
+    ADK_CHECK(!other.restore<position, health>(buffer));
+
+    // Truncated data fails
+    for (const std::size_t size : { std::size_t(0), std::size_t(10), buffer.size() / 2, buffer.size() - 1 }) {
+        registry truncated;
+        ADK_CHECK(!truncated.restore<position, stats_block>(std::span(buffer).subspan(0, size)));
+    }
+    ADK_CHECK(reg.valid(ids[0]));
+}
+
+ADK_TEST(snapshot_rejects_malformed_data)
+{
+    registry reg;
+    const auto ids = reg.create_n(4, position{});
+    reg.assign<marked>(ids[0], marked{});
+    reg.delete_entity(ids[1]);
+    reg.delete_entity(ids[2]);
+    std::vector<std::byte> buffer;
+    reg.snapshot<position, marked>(buffer);
+
+    // Header, entity and free counts, free list head, 4 entities, then the
+    // position pool with its count and 2 entities, then the marked list
+    constexpr std::size_t slot_count = 16;
+    constexpr std::size_t free_count = 24;
+    constexpr std::size_t free_head = 32;
+    constexpr std::size_t slots = 36;
+    constexpr std::size_t position_count = 56;
+    constexpr std::size_t position_entities = 64;
+    constexpr std::size_t marked_entities = 100;
+    ADK_CHECK(buffer.size() == marked_entities + sizeof(entity));
+    ADK_CHECK(registry().restore<position, marked>(buffer));
+
+    const auto rejected = [](const std::vector<std::byte>& data) {
+        registry restored;
+        return !restored.restore<position, marked>(data);
+    };
+    // Counts that don't fit in the data are rejected before allocating for them
+    ADK_CHECK(rejected(patched(buffer, slot_count, std::uint64_t(1) << 30)));
+    ADK_CHECK(rejected(patched(buffer, position_count, std::uint64_t(1) << 60)));
+    std::stringstream stream;
+    const auto oversized = patched(buffer, position_count, std::uint64_t(1) << 60);
+    stream.write(reinterpret_cast<const char*>(oversized.data()), std::streamsize(oversized.size()));
+    ADK_CHECK(!registry().restore<position, marked>(stream));
+    // The free list must link exactly the free slots
+    ADK_CHECK(rejected(patched(buffer, free_count, std::uint64_t(1))));
+    ADK_CHECK(rejected(patched(buffer, free_count, std::uint64_t(3))));
+    ADK_CHECK(rejected(patched(buffer, free_head, entity(9))));
+    ADK_CHECK(rejected(patched(buffer, free_head, entity(3))));
+    // The list runs 2 then 1, pointing 1 back at 2 goes in circles
+    ADK_CHECK(rejected(patched(buffer, slots + sizeof(entity), adk::ecs::internal::set_entity_index<entity>(0, 2))));
+    // Components of dead entities or given twice
+    ADK_CHECK(rejected(patched(buffer, position_entities, ids[1])));
+    ADK_CHECK(rejected(patched(buffer, position_entities + sizeof(entity), ids[0])));
+    ADK_CHECK(rejected(patched(buffer, marked_entities, ids[2])));
+}
+
+ADK_TEST(snapshot_failed_restore_leaves_usable_registry)
+{
+    registry reg;
+    const auto ids = build(reg);
+    std::vector<std::byte> buffer;
+    reg.snapshot<position, stats_block, marked>(buffer);
+
+    // Cut inside the component data, past the header and entity array
+    for (const std::size_t cut : { std::size_t(1), std::size_t(4), buffer.size() / 4 }) {
+        registry truncated;
+        const auto mine = truncated.create_n(3, position{}, stats_block{ 1, 1.0f });
+        ADK_CHECK(!truncated.restore<position, stats_block, marked>(std::span(buffer).subspan(0, buffer.size() - cut)));
+
+        bool empty = true;
+        for (const auto e : ids) {
+            empty = empty && !truncated.valid(e);
+        }
+        for (const auto e : mine) {
+            empty = empty && !truncated.valid(e);
+        }
+        ADK_CHECK(empty && truncated.stats().live_entities == 0);
+        std::size_t count = 0;
+        truncated.for_each<position>([&](entity, position&) { count++; });
+        truncated.for_each<stats_block>([&](entity, stats_block&) { count++; });
+        ADK_CHECK(count == 0);
+
+        // And it works as usual afterwards
+        const auto e = truncated.new_entity();
+        truncated.assign<stats_block>(e, stats_block{ 4, 2.0f });
+        ADK_CHECK(truncated.has<stats_block>(e) && !truncated.has<position>(e));
+        ADK_CHECK(truncated.get<stats_block>(e).level == 4);
+
+        // A later snapshot restores over it
+        ADK_CHECK(truncated.restore<position, stats_block, marked>(buffer));
+        ADK_CHECK(same_state(truncated, ids));
+    }
+}
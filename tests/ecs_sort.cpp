@@ -0,0 +1,105 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <random>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct depth_key
+{
+    int value = 0;
+    entity owner = 0;
+};
+
+std::vector<int> pool_order(registry& reg)
+{
+    std::vector<int> values;
+    reg.for_each<depth_key>([&](entity e, depth_key& key) {
+        // Components must still belong to their entities after sorting
+        ADK_CHECK(key.owner == e);
+        values.push_back(key.value);
+    });
+    return values;
+}
+
+} // namespace
+
+ADK_TEST(sort_orders_pool)
+{
+    registry reg;
+    std::mt19937 random(3);
+    for (int i = 0; i < 2000; i++) {
+        const auto e = reg.new_entity();
+        reg.assign<depth_key>(e, depth_key{ int(random() % 1000), e });
+    }
+    const auto by_value = [](const depth_key& a, const depth_key& b) { return a.value < b.value; };
+    reg.sort<depth_key>(by_value);
+    auto values = pool_order(reg);
+    ADK_CHECK(values.size() == 2000);
+    ADK_CHECK(std::is_sorted(values.begin(), values.end()));
+
+    // Nudge a few keys and sort again, which takes the insertion sort path
+    int nudged = 0;
+    reg.for_each<depth_key>([&](entity, depth_key& key) {
+        if (nudged++ % 97 == 0) {
+            key.value += 3;
+        }
+    });
+    reg.sort<depth_key>(by_value);
+    values = pool_order(reg);
+    ADK_CHECK(std::is_sorted(values.begin(), values.end()));
+
+    // Reverse order
+    reg.sort<depth_key>([](const depth_key& a, const depth_key& b) { return a.value > b.value; });
+    values = pool_order(reg);
+    ADK_CHECK(std::is_sorted(values.rbegin(), values.rend()));
+}
+
+ADK_TEST(sort_follows_other_pool)
+{
+    registry reg;
+    std::vector<entity> ids;
+    for (int i = 0; i < 100; i++) {
+        ids.push_back(reg.new_entity());
+        reg.assign<depth_key>(ids.back(), depth_key{ 100 - i, ids.back() });
+    }
+    // Only some entities have a health, added in a different order
+    for (int i = 99; i >= 0; i -= 3) {
+        reg.assign<health>(ids[i], health{ i });
+    }
+    reg.sort<depth_key>([](const depth_key& a, const depth_key& b) { return a.value < b.value; });
+    reg.sort<depth_key, health>();
+
+    std::vector<entity> key_order;
+    reg.for_each<depth_key>([&](entity e, depth_key&) {
+        if (reg.has<health>(e)) {
+            key_order.push_back(e);
+        }
+    });
+    std::vector<entity> health_order;
+    reg.for_each<health>([&](entity e, health& h) {
+        ADK_CHECK(ids[h.value] == e);
+        health_order.push_back(e);
+    });
+    ADK_CHECK(health_order == key_order);
+}
+
+ADK_TEST(sort_keeps_change_tracking)
+{
+    registry reg;
+    reg.track<depth_key>();
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<depth_key>(a, depth_key{ 2, a });
+    reg.assign<depth_key>(b, depth_key{ 1, b });
+    reg.clear_changes();
+    reg.patch<depth_key>(a, [](depth_key&) {});
+    reg.sort<depth_key>([](const depth_key& x, const depth_key& y) { return x.value < y.value; });
+
+    std::vector<entity> changed;
+    reg.for_each<adk::ecs::changed<depth_key>>([&](entity e, depth_key&) { changed.push_back(e); });
+    ADK_CHECK((changed == std::vector<entity>{ a }));
+}
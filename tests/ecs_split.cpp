@@ -0,0 +1,113 @@
+#include "test.hpp"
+
+#include <adk/adk_reflect.hpp>
+
+#include <atomic>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct particle
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float vx = 0.0f;
+    int age = 0;
+};
+
+} // namespace
+
+ADK_REFLECT_CLASS(particle, x, y, vx, age)
+
+template <>
+struct adk::ecs::component_traits<particle>
+{
+    static constexpr bool split_members = true;
+};
+
+using adk::ecs::members;
+
+ADK_TEST(split_get_patch_and_columns)
+{
+    registry reg;
+    const auto ids = reg.create_n(10, particle{ 1.0f, 2.0f, 0.5f, 0 });
+    reg.patch<particle>(ids[3], [](particle& p) { p.age = 7; });
+    const particle copy = reg.get<particle>(ids[3]);
+    ADK_CHECK(copy.x == 1.0f && copy.y == 2.0f && copy.vx == 0.5f && copy.age == 7);
+
+    auto [entities, x, vx] = reg.columns<particle, 0, 2>();
+    ADK_CHECK(entities.size() == 10 && x.size() == 10 && vx.size() == 10);
+    for (std::size_t i = 0; i < entities.size(); i++) {
+        x[i] += vx[i];
+    }
+    ADK_CHECK(reg.get<particle>(ids[9]).x == 1.5f);
+
+    // Removal keeps the columns in step
+    reg.delete_entity(ids[0]);
+    ADK_CHECK(reg.get<particle>(ids[3]).age == 7 && reg.get<particle>(ids[9]).y == 2.0f);
+}
+
+ADK_TEST(split_members_in_views)
+{
+    registry reg;
+    const auto moving = reg.create_n(20, particle{ 0.0f, 0.0f, 2.0f, 0 }, velocity{});
+    const auto still = reg.create_n(30, particle{ 0.0f, 0.0f, 1.0f, 0 });
+    reg.assign<frozen>(moving[0], frozen{});
+
+    // Columns join with other components and filters
+    std::size_t count = 0;
+    reg.for_each<members<particle, 0, 2>, velocity, adk::ecs::exclude<frozen>>([&](entity, float& x, float& vx, velocity&) {
+        x += vx;
+        count++;
+    });
+    ADK_CHECK(count == 19);
+    ADK_CHECK(reg.get<particle>(moving[1]).x == 2.0f && reg.get<particle>(moving[0]).x == 0.0f);
+    ADK_CHECK(reg.get<particle>(still[0]).x == 0.0f);
+
+    // The type on its own only filters
+    count = 0;
+    reg.for_each<particle, velocity>([&](entity, velocity& v) {
+        v.x = 1.0f;
+        count++;
+    });
+    ADK_CHECK(count == 20);
+
+    // Driven by the split pool
+    count = 0;
+    reg.for_each<members<particle, 3>>([&](entity e, int& age) {
+        age = int(count++);
+        ADK_CHECK(reg.get<particle>(e).age == age);
+    });
+    ADK_CHECK(count == 50);
+
+    adk::ecs::thread_pool pool(2);
+    std::atomic<std::size_t> parallel = 0;
+    reg.par_for_each<members<particle, 1>>(pool, [&](entity, float& y) {
+        y = 5.0f;
+        parallel++;
+    });
+    ADK_CHECK(parallel == 50 && reg.get<particle>(still[29]).y == 5.0f);
+}
+
+ADK_TEST(split_tracking)
+{
+    registry reg;
+    reg.track<particle>();
+    const auto old = reg.create_n(5, particle{});
+    reg.clear_changes();
+    const auto fresh = reg.create_n(3, particle{});
+    reg.patch<particle>(old[1], [](particle& p) { p.age = 3; });
+
+    std::vector<entity> added;
+    reg.for_each<adk::ecs::added<particle>>([&](entity e) { added.push_back(e); });
+    ADK_CHECK(added == fresh);
+
+    std::vector<entity> changed;
+    reg.for_each<adk::ecs::changed<members<particle, 3>>>([&](entity e, int& age) {
+        ADK_CHECK(age == 3);
+        changed.push_back(e);
+    });
+    ADK_CHECK((changed == std::vector<entity>{ old[1] }));
+}
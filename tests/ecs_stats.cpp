@@ -0,0 +1,140 @@
+#include "test.hpp"
+
+#include <algorithm>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct ballast
+{
+    char bytes[100] = {};
+};
+
+const adk::ecs::pool_stats* find_pool(const adk::ecs::registry_stats& stats, std::size_t id)
+{
+    const auto it = std::find_if(stats.pools.begin(), stats.pools.end(),
+        [id](const adk::ecs::pool_stats& pool) { return pool.component_id == id; });
+    return it == stats.pools.end() ? nullptr : &*it;
+}
+
+} // namespace
+
+ADK_TEST(stats_counts_entities_and_pools)
+{
+    registry reg;
+    const auto ids = reg.create_n(100, position{});
+    reg.create_n(40, position{}, ballast{});
+    reg.destroy_range(std::span(ids).subspan(0, 30));
+
+    const auto stats = reg.stats();
+    ADK_CHECK(stats.entity_slots == 140);
+    ADK_CHECK(stats.live_entities == 110);
+    ADK_CHECK(stats.free_slots == 30);
+    ADK_CHECK(stats.pools.size() == 2);
+    ADK_CHECK(stats.memory.bytes_in_use == reg.memory_usage().bytes_in_use);
+
+    const auto positions = find_pool(stats, adk::ecs::internal::get_component_id<position>());
+    const auto ballasts = find_pool(stats, adk::ecs::internal::get_component_id<ballast>());
+    ADK_CHECK(positions && positions->size == 110 && positions->capacity >= 110);
+    ADK_CHECK(positions && positions->name.find("position") != std::string_view::npos);
+    ADK_CHECK(ballasts && ballasts->size == 40);
+    // The bigger component shows up as the bigger pool
+    ADK_CHECK(ballasts && ballasts->bytes >= 40 * sizeof(ballast) && ballasts->bytes > positions->bytes);
+
+    // Reserved ids aren't live until flushed
+    reg.reserve_entity();
+    ADK_CHECK(reg.stats().live_entities == 110);
+    reg.flush_reserved();
+    ADK_CHECK(reg.stats().live_entities == 111);
+}
+
+ADK_TEST(stats_queries)
+{
+    registry reg;
+    reg.create_n(10, position{}, health{});
+    reg.create_n(30, position{});
+    std::size_t visited = 0;
+    reg.for_each<position, health>([&](entity, position&, health&) { visited++; });
+    reg.for_each<position, health>([&](entity, position&, health&) { visited++; });
+    ADK_CHECK(visited == 20);
+
+    const auto stats = reg.stats();
+#ifdef ADK_ECS_INSTRUMENTATION
+    ADK_CHECK(stats.queries.size() == 1);
+    const auto& query = stats.queries[0];
+    ADK_CHECK(query.timing.count == 2);
+    ADK_CHECK(query.name.find("position") != std::string_view::npos);
+    // The view walks the smaller health pool, every candidate matches
+    ADK_CHECK(query.candidates == 20 && query.rejections == 0);
+
+    adk::ecs::thread_pool pool(2);
+    reg.par_for_each<position>(pool, [&](entity, position&) {});
+    const auto after = reg.stats();
+    ADK_CHECK(after.queries.size() == 2);
+    ADK_CHECK(after.view_candidates == 60 && after.view_rejections == 0);
+#else
+    // Compiled out by default
+    ADK_CHECK(stats.queries.empty() && stats.view_candidates == 0);
+#endif
+}
+
+ADK_TEST(stats_signature_scans)
+{
+    registry reg;
+    reg.create_n(100, frozen{});
+    reg.create_n(100, position{});
+    std::size_t tagged = 0;
+    reg.for_each<frozen>([&](entity, frozen&) { tagged++; });
+    std::size_t bare = 0;
+    reg.for_each<adk::ecs::exclude<position>>([&](entity) { bare++; });
+    ADK_CHECK(tagged == 100 && bare == 100);
+
+#ifdef ADK_ECS_INSTRUMENTATION
+    // Views without a pool to drive them scan every slot, first block included
+    const auto stats = reg.stats();
+    ADK_CHECK(stats.queries.size() == 2);
+    for (const auto& query : stats.queries) {
+        ADK_CHECK(query.candidates == 200 && query.rejections == 100);
+    }
+#endif
+}
+
+ADK_TEST(stats_systems)
+{
+    registry reg;
+    reg.create_n(10, position{}, health{});
+    adk::ecs::thread_pool pool(2);
+    scheduler frame(reg, pool);
+    frame.add<adk::ecs::system<adk::ecs::reads<>, adk::ecs::writes<health>>>([](entity, health& h) { h.value++; }, "heal");
+    frame.run();
+    frame.run();
+    frame.run();
+
+    const auto stats = frame.stats();
+    ADK_CHECK(stats.size() == 1 && stats[0].name == "heal");
+#ifdef ADK_ECS_INSTRUMENTATION
+    ADK_CHECK(stats[0].timing.count == 3);
+    std::uint64_t bucketed = 0;
+    for (const auto count : stats[0].timing.buckets) {
+        bucketed += count;
+    }
+    ADK_CHECK(bucketed == 3 && stats[0].timing.max_ns * 3 >= stats[0].timing.total_ns);
+#else
+    ADK_CHECK(stats[0].timing.count == 0);
+#endif
+}
+
+ADK_TEST(stats_timing_histogram)
+{
+    adk::ecs::timing_histogram histogram;
+    histogram.record(0);
+    histogram.record(1);
+    histogram.record(1000);
+    histogram.record(std::uint64_t(1) << 50);
+    ADK_CHECK(histogram.buckets[0] == 2);
+    ADK_CHECK(histogram.buckets[9] == 1);
+    ADK_CHECK(histogram.buckets.back() == 1);
+    ADK_CHECK(histogram.count == 4 && histogram.max_ns == std::uint64_t(1) << 50);
+}
@@ -0,0 +1,122 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <utility>
+
+using namespace adk::test;
+
+ADK_TEST(storage_assign_get)
+{
+    registry reg;
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<position>(a, position{ 1.0f, 2.0f });
+    reg.assign<position>(b, position{ 3.0f, 4.0f });
+    ADK_CHECK(reg.has<position>(a) && reg.has<position>(b));
+    ADK_CHECK(!reg.has<velocity>(a));
+    ADK_CHECK(reg.get<position>(a).x == 1.0f && reg.get<position>(a).y == 2.0f);
+    ADK_CHECK(reg.get<position>(b).x == 3.0f && reg.get<position>(b).y == 4.0f);
+
+    reg.get<position>(a).x = 5.0f;
+    ADK_CHECK(reg.get<position>(a).x == 5.0f);
+}
+
+ADK_TEST(storage_swap_remove_keeps_other_components)
+{
+    registry reg;
+    std::vector<entity> ids;
+    for (int i = 0; i < 8; i++) {
+        ids.push_back(reg.new_entity());
+        reg.assign<health>(ids.back(), health{ i });
+    }
+    // Removing from the middle moves the last component into the hole
+    reg.unassign<health>(ids[2]);
+    reg.unassign<health>(ids[0]);
+    reg.unassign<health>(ids[7]);
+    for (int i = 0; i < 8; i++) {
+        const bool removed = i == 0 || i == 2 || i == 7;
+        ADK_CHECK(reg.has<health>(ids[i]) == !removed);
+        if (!removed) {
+            ADK_CHECK(reg.get<health>(ids[i]).value == i);
+        }
+    }
+
+    reg.assign<health>(ids[2], health{ 20 });
+    ADK_CHECK(reg.get<health>(ids[2]).value == 20);
+    ADK_CHECK(reg.get<health>(ids[6]).value == 6);
+}
+
+ADK_TEST(storage_delete_entity_removes_components)
+{
+    registry reg;
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<position>(a, position{ 1.0f, 1.0f });
+    reg.assign<velocity>(a, velocity{ 2.0f, 2.0f });
+    reg.assign<position>(b, position{ 3.0f, 3.0f });
+    reg.delete_entity(a);
+    ADK_CHECK(!reg.valid(a));
+    ADK_CHECK(reg.valid(b));
+    ADK_CHECK(reg.get<position>(b).x == 3.0f);
+
+    std::size_t count = 0;
+    reg.for_each<position>([&](entity, position&) { count++; });
+    ADK_CHECK(count == 1);
+}
+
+ADK_TEST(storage_scales_with_component_count)
+{
+    struct rare_component
+    {
+        int value = 0;
+    };
+
+    registry reg;
+    const auto ids = reg.create_n(60000);
+    reg.assign<rare_component>(ids.back(), rare_component{ 7 });
+    ADK_CHECK(reg.get<rare_component>(ids.back()).value == 7);
+
+    // The pool holds one component whatever the index of its entity
+    const auto stats = reg.stats();
+    const auto pool = std::find_if(stats.pools.begin(), stats.pools.end(), [](const adk::ecs::pool_stats& pool) {
+        return pool.component_id == adk::ecs::internal::get_component_id<rare_component>();
+    });
+    ADK_CHECK(pool != stats.pools.end());
+    ADK_CHECK(pool->size == 1);
+    ADK_CHECK(pool->capacity < 16);
+}
+
+template <int N>
+struct numbered
+{
+    int value = N;
+};
+
+ADK_TEST(storage_pools_indexed_by_component_id)
+{
+    registry reg;
+    const auto e = reg.new_entity();
+    [&]<int... N>(std::integer_sequence<int, N...>) {
+        (reg.assign<numbered<N>>(e, numbered<N>{ N * 10 }), ...);
+        ADK_CHECK(((reg.get<numbered<N>>(e).value == N * 10) && ...));
+    }(std::make_integer_sequence<int, 12>());
+
+    // Each type keeps the id it was first given
+    const auto first = adk::ecs::internal::get_component_id<numbered<0>>();
+    ADK_CHECK(adk::ecs::internal::get_component_id<numbered<0>>() == first);
+    ADK_CHECK(adk::ecs::internal::get_component_id<numbered<0>>() != adk::ecs::internal::get_component_id<numbered<1>>());
+    ADK_CHECK(reg.stats().pools.size() == 12);
+}
+
+ADK_TEST(storage_registries_have_separate_pools)
+{
+    registry a;
+    registry b;
+    const auto in_a = a.new_entity();
+    const auto in_b = b.new_entity();
+    ADK_CHECK(in_a == in_b);
+    a.assign<health>(in_a, health{ 1 });
+    b.assign<health>(in_b, health{ 2 });
+    ADK_CHECK(a.get<health>(in_a).value == 1);
+    ADK_CHECK(b.get<health>(in_b).value == 2);
+}
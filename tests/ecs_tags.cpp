@@ -0,0 +1,49 @@
+#include "test.hpp"
+
+using namespace adk::test;
+
+namespace
+{
+
+struct enemy {};
+
+} // namespace
+
+ADK_TEST(tags_have_no_pool)
+{
+    registry reg;
+    const auto ids = reg.create_n(100, enemy{});
+    ADK_CHECK(reg.stats().pools.empty());
+    ADK_CHECK(reg.has<enemy>(ids[0]));
+    ADK_CHECK(&reg.get<enemy>(ids[0]) == &reg.get<enemy>(ids[1]));
+
+    reg.unassign<enemy>(ids[0]);
+    ADK_CHECK(!reg.has<enemy>(ids[0]));
+    reg.assign<enemy>(ids[0], enemy{});
+    ADK_CHECK(reg.has<enemy>(ids[0]));
+    ADK_CHECK(reg.stats().pools.empty());
+}
+
+ADK_TEST(tags_filter_views)
+{
+    registry reg;
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<health>(a, health{ 1 });
+    reg.assign<health>(b, health{ 2 });
+    reg.assign<enemy>(b, enemy{});
+
+    std::size_t count = 0;
+    reg.for_each<health, enemy>([&](entity e, health& h, enemy&) {
+        ADK_CHECK(e == b && h.value == 2);
+        count++;
+    });
+    ADK_CHECK(count == 1);
+
+    reg.delete_entity(b);
+    const auto reused = reg.new_entity();
+    ADK_CHECK(!reg.has<enemy>(reused));
+    count = 0;
+    reg.for_each<enemy>([&](entity, enemy&) { count++; });
+    ADK_CHECK(count == 0);
+}
@@ -0,0 +1,141 @@
+#include "test.hpp"
+
+#include <algorithm>
+
+using namespace adk::test;
+
+namespace
+{
+
+struct tracked
+{
+    int value = 0;
+};
+
+template <typename... Terms>
+std::vector<entity> matches(registry& reg)
+{
+    std::vector<entity> result;
+    for (const auto& match : reg.new_view<Terms...>()) {
+        result.push_back(std::get<0>(match));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+} // namespace
+
+ADK_TEST(tracking_added_changed_removed)
+{
+    registry reg;
+    const auto existing = reg.new_entity();
+    reg.assign<tracked>(existing, tracked{});
+    reg.track<tracked>();
+
+    // Components that existed before tracking aren't added
+    ADK_CHECK(matches<adk::ecs::added<tracked>>(reg).empty());
+
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<tracked>(a, tracked{ 1 });
+    reg.assign<tracked>(b, tracked{ 2 });
+    ADK_CHECK((matches<adk::ecs::added<tracked>>(reg) == std::vector<entity>{ a, b }));
+    ADK_CHECK(matches<adk::ecs::changed<tracked>>(reg).empty());
+
+    reg.patch<tracked>(existing, [](tracked& t) { t.value = 5; });
+    reg.patch<tracked>(existing).value++;
+    ADK_CHECK((matches<adk::ecs::changed<tracked>>(reg) == std::vector<entity>{ existing }));
+    ADK_CHECK(reg.get<tracked>(existing).value == 6);
+
+    reg.unassign<tracked>(a);
+    ADK_CHECK((matches<adk::ecs::added<tracked>>(reg) == std::vector<entity>{ b }));
+    ADK_CHECK(reg.removed<tracked>().size() == 1 && reg.removed<tracked>()[0] == a);
+
+    reg.clear_changes();
+    ADK_CHECK(matches<adk::ecs::added<tracked>>(reg).empty());
+    ADK_CHECK(matches<adk::ecs::changed<tracked>>(reg).empty());
+    ADK_CHECK(reg.removed<tracked>().empty());
+}
+
+ADK_TEST(tracking_readded_component_counts_once)
+{
+    registry reg;
+    reg.track<tracked>();
+    const auto e = reg.new_entity();
+    reg.assign<tracked>(e, tracked{});
+    reg.unassign<tracked>(e);
+    reg.assign<tracked>(e, tracked{});
+    ADK_CHECK((matches<adk::ecs::added<tracked>>(reg) == std::vector<entity>{ e }));
+
+    // A deleted entity whose slot was reused isn't reported for the new id
+    reg.delete_entity(e);
+    const auto reused = reg.new_entity();
+    ADK_CHECK(matches<adk::ecs::added<tracked>>(reg).empty());
+    reg.assign<tracked>(reused, tracked{});
+    ADK_CHECK((matches<adk::ecs::added<tracked>>(reg) == std::vector<entity>{ reused }));
+}
+
+ADK_TEST(tracking_filters_combine_with_components)
+{
+    registry reg;
+    reg.track<tracked>();
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<tracked>(a, tracked{});
+    reg.assign<tracked>(b, tracked{});
+    reg.assign<position>(b, position{});
+    ADK_CHECK((matches<adk::ecs::added<tracked>, position>(reg) == std::vector<entity>{ b }));
+    ADK_CHECK((matches<adk::ecs::added<tracked>, adk::ecs::exclude<position>>(reg) == std::vector<entity>{ a }));
+}
+
+ADK_TEST(tracking_callbacks)
+{
+    registry reg;
+    std::vector<entity> constructed;
+    std::vector<entity> destroyed;
+    reg.on_construct<health>([&](registry& r, entity e) {
+        ADK_CHECK(r.has<health>(e));
+        constructed.push_back(e);
+    });
+    reg.on_destroy<health>([&](registry& r, entity e) {
+        // Called before the component goes away
+        ADK_CHECK(r.has<health>(e) && r.get<health>(e).value == 4);
+        destroyed.push_back(e);
+    });
+    const auto a = reg.new_entity();
+    const auto b = reg.new_entity();
+    reg.assign<health>(a, health{ 4 });
+    reg.assign<health>(b, health{ 4 });
+    reg.unassign<health>(a);
+    reg.delete_entity(b);
+    reg.delete_entity(a);
+    ADK_CHECK((constructed == std::vector<entity>{ a, b }));
+    ADK_CHECK((destroyed == std::vector<entity>{ a, b }));
+
+    const auto more = reg.create_n(3, health{ 4 });
+    ADK_CHECK(constructed.size() == 5);
+    reg.destroy_range(more);
+    ADK_CHECK(destroyed.size() == 5);
+}
+
+ADK_TEST(tracking_destroy_sees_every_component)
+{
+    registry reg;
+    std::size_t intact = 0;
+    // Either listener can read the other component, whichever pool goes first
+    reg.on_destroy<position>([&](registry& r, entity e) {
+        intact += r.has<position>(e) && r.has<velocity>(e) && r.get<velocity>(e).x == 2.0f;
+    });
+    reg.on_destroy<velocity>([&](registry& r, entity e) {
+        intact += r.has<position>(e) && r.has<velocity>(e) && r.get<position>(e).x == 1.0f;
+    });
+    const auto ids = reg.create_n(4, position{ 1.0f, 0.0f }, velocity{ 2.0f, 0.0f });
+    reg.delete_entity(ids[0]);
+    ADK_CHECK(intact == 2);
+
+    // Passed twice but only notified once
+    const std::vector<entity> range = { ids[1], ids[2], ids[1], ids[3] };
+    reg.destroy_range(range);
+    ADK_CHECK(intact == 8);
+    ADK_CHECK(reg.stats().live_entities == 0);
+}
@@ -0,0 +1,80 @@
+#include "test.hpp"
+
+#include <algorithm>
+
+using namespace adk::test;
+
+ADK_TEST(view_matches_every_entity_with_all_types)
+{
+    registry reg;
+    std::vector<entity> both;
+    for (int i = 0; i < 100; i++) {
+        const auto e = reg.new_entity();
+        reg.assign<position>(e, position{ float(i), 0.0f });
+        if (i % 10 == 0) {
+            reg.assign<velocity>(e, velocity{ float(i), 0.0f });
+            both.push_back(e);
+        }
+    }
+
+    std::vector<entity> seen;
+    reg.for_each<position, velocity>([&](entity e, position& p, velocity& v) {
+        ADK_CHECK(p.x == v.x);
+        seen.push_back(e);
+    });
+    std::sort(seen.begin(), seen.end());
+    ADK_CHECK(seen == both);
+
+    // Same matches whichever order the types are passed in
+    seen.clear();
+    reg.for_each<velocity, position>([&](entity e, velocity&, position&) { seen.push_back(e); });
+    std::sort(seen.begin(), seen.end());
+    ADK_CHECK(seen == both);
+}
+
+ADK_TEST(view_is_driven_by_smallest_pool)
+{
+    registry reg;
+    for (int i = 0; i < 1000; i++) {
+        const auto e = reg.new_entity();
+        reg.assign<position>(e, position{});
+        if (i % 100 == 0) {
+            reg.assign<velocity>(e, velocity{});
+        }
+    }
+    ADK_CHECK(reg.new_view<position, velocity>().size_hint() == 10);
+    ADK_CHECK(reg.new_view<velocity, position>().size_hint() == 10);
+    ADK_CHECK(reg.new_view<position>().size_hint() == 1000);
+}
+
+ADK_TEST(view_without_pool_is_empty)
+{
+    struct never_assigned
+    {
+        int value = 0;
+    };
+
+    registry reg;
+    const auto e = reg.new_entity();
+    reg.assign<position>(e, position{});
+    std::size_t count = 0;
+    reg.for_each<position, never_assigned>([&](entity, position&, never_assigned&) { count++; });
+    ADK_CHECK(count == 0);
+    ADK_CHECK(reg.new_view<position, never_assigned>().size_hint() == 0);
+}
+
+ADK_TEST(view_skips_deleted_entities)
+{
+    registry reg;
+    const auto ids = reg.create_n(10, position{}, velocity{});
+    reg.delete_entity(ids[3]);
+    reg.unassign<velocity>(ids[5]);
+
+    std::vector<entity> seen;
+    for (auto [e, p, v] : reg.new_view<position, velocity>()) {
+        seen.push_back(e);
+    }
+    ADK_CHECK(seen.size() == 8);
+    ADK_CHECK(std::find(seen.begin(), seen.end(), ids[3]) == seen.end());
+    ADK_CHECK(std::find(seen.begin(), seen.end(), ids[5]) == seen.end());
+}
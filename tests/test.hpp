@@ -0,0 +1,101 @@
+/*
+    Minimal test harness for the ADK tests, no outside dependencies.
+
+    Tests are registered with ADK_TEST(name) and use ADK_CHECK, which records
+    the failure and carries on so one run reports every broken check. The
+    executable runs every test, or only those whose name contains the first
+    argument, and exits non-zero if any check failed.
+*/
+
+#ifndef ADK_TEST_HPP
+#define ADK_TEST_HPP
+
+// Library assertions stay on whatever the build type
+#undef NDEBUG
+#define ADK_USE_ASSERTIONS
+
+#include <adk/adk_ecs.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace adk::test
+{
+
+struct test_case
+{
+    const char* name;
+    void (*func)();
+};
+
+inline std::vector<test_case>& test_cases()
+{
+    static std::vector<test_case> cases;
+    return cases;
+}
+
+inline std::atomic<std::size_t> failures = 0;
+
+struct test_registrar
+{
+    test_registrar(const char* name, void (*func)())
+    {
+        test_cases().push_back({ name, func });
+    }
+};
+
+inline bool check(bool condition, const char* expression, const char* file, int line)
+{
+    if (!condition) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        failures++;
+    }
+    return condition;
+}
+
+// Component ids are global to the process, so every test shares one signature
+// width wide enough for all of the component types used across the tests
+constexpr std::size_t SIGNATURE_BITS = 256;
+
+using registry = adk::ecs::registry<std::uint32_t, SIGNATURE_BITS>;
+using entity = registry::entity_id_type;
+using command_buffer = adk::ecs::command_buffer<std::uint32_t, SIGNATURE_BITS>;
+using prefab = adk::ecs::prefab<std::uint32_t, SIGNATURE_BITS>;
+using scheduler = adk::ecs::scheduler<std::uint32_t, SIGNATURE_BITS>;
+using relationship = adk::ecs::relationship<std::uint32_t>;
+
+struct position
+{
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+struct velocity
+{
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+struct health
+{
+    int value = 0;
+};
+
+struct frozen {};
+
+} // namespace adk::test
+
+#define ADK_TEST_CONCAT_IMPL(a, b) a##b
+#define ADK_TEST_CONCAT(a, b) ADK_TEST_CONCAT_IMPL(a, b)
+
+#define ADK_TEST(name)                                                                  \
+    static void name();                                                                 \
+    static const ::adk::test::test_registrar ADK_TEST_CONCAT(name, _registrar)(#name, name); \
+    static void name()
+
+#define ADK_CHECK(...) ::adk::test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,20 @@
+#include "test.hpp"
+
+#include <cstring>
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    std::size_t run = 0;
+    for (const auto& test : adk::test::test_cases()) {
+        if (std::strstr(test.name, filter) == nullptr) {
+            continue;
+        }
+        const auto before = adk::test::failures.load();
+        test.func();
+        std::printf("%s %s\n", adk::test::failures.load() == before ? "[pass]" : "[FAIL]", test.name);
+        run++;
+    }
+    std::printf("%zu tests, %zu failed checks\n", run, adk::test::failures.load());
+    return adk::test::failures.load() == 0 && run > 0 ? 0 : 1;
+}